@@ -0,0 +1,368 @@
+// Бенчмарк Altium Converter: генератор синтетических pick-and-place / базы компонентов
+// и замеры отдельных этапов и полной конвертации.
+//
+//   g++ -std=c++17 -O2 -pthread -o altium_bench Bench.cpp
+//   ./altium_bench --rows 1000000 --db 100000 --files 32 --work bench_work > bench.json
+//
+// Генератор детерминирован (--seed), результаты — JSON-массив в stdout
+// (items/s, MB/s, пиковый RSS), краткая таблица — в stderr.
+
+#define ALTIUM_CONVERTER_NO_MAIN
+#include "MasterFile.cpp"
+
+#include <chrono>
+#include <cstdio>
+
+#ifdef _WIN32
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace bench {
+
+// -------- Детерминированный генератор --------
+class Rng {
+public:
+    explicit Rng(uint64_t seed) : s_(seed) {}
+    uint64_t next() { // splitmix64
+        uint64_t z = (s_ += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+    size_t below(size_t n)      { return n ? (size_t)(next() % n) : 0; }
+    bool   chance(double p)     { return (next() >> 11) * (1.0 / 9007199254740992.0) < p; }
+    template <class T> const T& pick(const std::vector<T>& v) { return v[below(v.size())]; }
+    // перекос к началу пула: частые корпуса встречаются на сотнях строк
+    size_t skewed(size_t n)     { size_t a = below(n), b = below(n); return std::min(a, b); }
+private:
+    uint64_t s_;
+};
+
+static const std::vector<std::string> kPkgs    = { "0402", "0603", "0805", "1206", "1210" };
+static const std::vector<std::string> kDiel    = { "X7R", "X5R", "NP0" };
+static const std::vector<std::string> kCapVals = { "10pF", "22pF", "100pF", "1nF", "10nF", "100nF", "1uF", "4.7uF", "10uF" };
+static const std::vector<std::string> kVolts   = { "6.3V", "10V", "16V", "25V", "50V", "100V" };
+static const std::vector<std::string> kPower   = { "0.063", "0.1", "0.125", "0.25", "1/16", "1/10" };
+static const std::vector<std::string> kResVals = { "0R", "10R", "100R", "1K", "4.7K", "10K", "47K", "100K", "1M" };
+static const std::vector<std::string> kIcs     = { "STM32F405RGT6", "LM358DR", "TPS5430DDA", "AMS1117-3.3", "SN74LVC1G08", "ATmega328P-AU" };
+static const std::vector<std::string> kMakers  = { "(Murata)", "(Yageo)", "(TDK)", "(Samsung)", "(KEMET)" };
+
+// подмешать кириллические двойники латинских букв (как при ручном вводе в русской раскладке)
+static std::string homoglyphs(Rng& r, const std::string& s) {
+    static const std::pair<char, const char*> cyr[] = {
+        {'X', u8"Х"}, {'C', u8"С"}, {'K', u8"К"}, {'P', u8"Р"}, {'A', u8"А"}, {'M', u8"М"}, {'T', u8"Т"},
+    };
+    std::string out;
+    for (char c : s) {
+        const char* rep = nullptr;
+        for (const auto& [lat, ru] : cyr) if (c == lat) rep = ru;
+        if (rep && r.chance(0.3)) out += rep; else out.push_back(c);
+    }
+    return out;
+}
+
+// «чистое» имя компонента из пула (то, что лежит в базе после нормализации)
+struct PartTemplate { char kind; std::string canonical; std::string raw; };
+
+static PartTemplate makePart(Rng& r, size_t id) {
+    PartTemplate p;
+    switch (id % 3) {
+        case 0: {
+            const std::string pkg = r.pick(kPkgs), diel = r.pick(kDiel), v = r.pick(kVolts), val = r.pick(kCapVals);
+            const std::string tol = r.chance(0.7) ? "-10%" : "-5%";
+            p.kind = 'C';
+            p.raw = pkg + (r.chance(0.2) ? " - " : "-") + diel + "-" + v + "-" + val + tol;
+            p.canonical = pkg + "-" + (diel == "NP0" ? "N" : "") + v + "-" + val + tol;
+            break;
+        }
+        case 1: {
+            const std::string pkg = r.pick(kPkgs), w = r.pick(kPower), val = r.pick(kResVals);
+            const std::string tol = r.chance(0.5) ? "-1%" : "-5%";
+            p.kind = 'R';
+            p.raw = pkg + "-" + w + "W-" + val + "-100ppm" + tol;
+            p.canonical = pkg + "-" + w + "W-" + val + tol;
+            break;
+        }
+        default:
+            p.kind = "UDLQ"[r.below(4)];
+            p.raw = p.canonical = r.pick(kIcs) + "-" + std::to_string(id);
+            break;
+    }
+    return p;
+}
+
+struct Corpus {
+    std::vector<PartTemplate> parts;   // пул компонентов
+    size_t known = 0;                  // первые known — есть в базе
+};
+
+static Corpus makeCorpus(Rng& r, size_t dbEntries) {
+    Corpus c;
+    const size_t pool = dbEntries + dbEntries / 10 + 16; // ~9% неизвестных
+    c.parts.reserve(pool);
+    for (size_t i = 0; i < pool; ++i) c.parts.push_back(makePart(r, i));
+    c.known = std::min(dbEntries, pool);
+    return c;
+}
+
+// Components/*.csv: nonstd;std;del
+static void writeComponentDb(Rng& r, const Corpus& c, const fs::path& dir, size_t files) {
+    fs::create_directories(dir);
+    std::vector<std::ofstream> outs;
+    for (size_t f = 0; f < files; ++f) {
+        outs.emplace_back(dir / ("Lib_" + std::to_string(f) + ".csv"), std::ios::binary | std::ios::trunc);
+        outs.back() << "Component_Name_Non_Standart;Component_Name_Standart;Delete_0_or_1\n";
+    }
+    for (size_t i = 0; i < c.known; ++i) {
+        const PartTemplate& p = c.parts[i];
+        const bool del = r.chance(0.02);
+        outs[i % files] << p.canonical << ";" << (del ? "" : "STD-" + p.canonical) << ";" << (del ? "1" : "0") << "\n";
+    }
+}
+
+// pick-and-place: Designator;X;Y;Rotation;Component;Layer;Comment
+static size_t writePlacement(Rng& r, const Corpus& c, const fs::path& path, size_t rows) {
+    static const char* rots[] = { "0", "90", "180", "270" };
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    std::string line;
+    size_t bytes = 0;
+    for (size_t i = 0; i < rows; ++i) {
+        const PartTemplate& p = c.parts[r.skewed(c.parts.size())];
+        std::string comp = p.raw;
+        if (r.chance(0.1)) comp += " " + r.pick(kMakers);
+        if (r.chance(0.1)) comp = homoglyphs(r, comp);
+        char xy[64];
+        std::snprintf(xy, sizeof xy, "%.3f;%.3f", (double)r.below(300000) / 1000.0, (double)r.below(200000) / 1000.0);
+        line = std::string(1, p.kind) + std::to_string(i + 1) + ";" + xy + ";" + rots[r.below(4)] + ";" + comp +
+               ";" + (r.chance(0.8) ? "Top" : "Bottom") + ";" + (r.chance(0.05) ? "DNP" : "") + "\r\n";
+        out << line;
+        bytes += line.size();
+    }
+    return bytes;
+}
+
+// -------- Замеры --------
+static uint64_t peakRssKb() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS pmc{};
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof pmc)) return pmc.PeakWorkingSetSize / 1024;
+    return 0;
+#else
+    rusage ru{};
+    getrusage(RUSAGE_SELF, &ru);
+#ifdef __APPLE__
+    return (uint64_t)ru.ru_maxrss / 1024;
+#else
+    return (uint64_t)ru.ru_maxrss;
+#endif
+#endif
+}
+
+struct Result { std::string name; uint64_t items = 0, bytes = 0; double seconds = 0; uint64_t peakRss = 0; };
+static std::vector<Result> gResults;
+
+template <class F>
+static void measure(const std::string& name, uint64_t items, uint64_t bytes, F&& body) {
+    auto t0 = std::chrono::steady_clock::now();
+    body();
+    const double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    Result res{ name, items, bytes, sec, peakRssKb() };
+    gResults.push_back(res);
+    std::fprintf(stderr, "%-28s %12.0f items/s %9.1f MB/s %8.3f s  rss %llu KB\n", name.c_str(),
+                 sec > 0 ? items / sec : 0.0, sec > 0 ? bytes / sec / 1e6 : 0.0, sec, (unsigned long long)res.peakRss);
+}
+
+static std::string jsonEscape(const std::string& s) {
+    std::string o;
+    for (char c : s) { if (c == '"' || c == '\\') o.push_back('\\'); o.push_back(c); }
+    return o;
+}
+
+static void printJson(const std::vector<std::pair<std::string, std::string>>& params) {
+    std::printf("{\n  \"params\": {");
+    for (size_t i = 0; i < params.size(); ++i)
+        std::printf("%s\"%s\": %s", i ? ", " : "", params[i].first.c_str(), params[i].second.c_str());
+    std::printf("},\n  \"results\": [\n");
+    for (size_t i = 0; i < gResults.size(); ++i) {
+        const Result& r = gResults[i];
+        std::printf("    {\"name\": \"%s\", \"items\": %llu, \"bytes\": %llu, \"seconds\": %.6f, "
+                    "\"items_per_s\": %.1f, \"mb_per_s\": %.3f, \"peak_rss_kb\": %llu}%s\n",
+                    jsonEscape(r.name).c_str(), (unsigned long long)r.items, (unsigned long long)r.bytes, r.seconds,
+                    r.seconds > 0 ? r.items / r.seconds : 0.0, r.seconds > 0 ? r.bytes / r.seconds / 1e6 : 0.0,
+                    (unsigned long long)r.peakRss, i + 1 < gResults.size() ? "," : "");
+    }
+    std::printf("  ]\n}\n");
+}
+
+// метка папки --work: её содержимое бенчмарк создаёт сам и может удалять
+static constexpr const char* kWorkMarker = ".altium_bench";
+
+static int run(int argc, char** argv) {
+    size_t rows = 200000, dbEntries = 20000, files = 16, dbFiles = 8, samples = 200000;
+    uint64_t seed = 42;
+    std::string work = "bench_work";
+    for (int i = 1; i < argc; ++i) {
+        const std::string a = argv[i];
+        auto num = [&]() -> size_t { return i + 1 < argc ? (size_t)std::strtoull(argv[++i], nullptr, 10) : 0; };
+        if      (a == "--rows")     rows = num();
+        else if (a == "--db")       dbEntries = num();
+        else if (a == "--files")    files = std::max<size_t>(num(), 1);
+        else if (a == "--db-files") dbFiles = std::max<size_t>(num(), 1);
+        else if (a == "--samples")  samples = num();
+        else if (a == "--seed")     seed = num();
+        else if (a == "-j" || a == "--jobs") gJobs = (unsigned)num();
+        else if (a == "--work" && i + 1 < argc) work = argv[++i];
+        else {
+            std::fprintf(stderr, "Usage: %s [--rows N] [--db N] [--files N] [--db-files N] [--samples N] "
+                                 "[--seed N] [-j N] [--work DIR]\n", argv[0]);
+            return a == "-h" || a == "--help" ? 0 : 2;
+        }
+    }
+
+    // папку чистим, только если её создал бенчмарк (есть метка) или она пуста:
+    // --work . или --work с настоящей базой Components не должны её стереть
+    std::error_code ec;
+    const fs::path marker = fs::path(work) / kWorkMarker;
+    if (fs::exists(work, ec) && !fs::is_empty(work, ec) && !fs::exists(marker, ec)) {
+        std::fprintf(stderr, "%s: not a bench work directory (no %s), refusing to clean it; pass an empty or new --work DIR\n",
+                     work.c_str(), kWorkMarker);
+        return 2;
+    }
+    fs::create_directories(work);
+    std::ofstream(marker).put('\n');
+    fs::current_path(work);
+    fs::remove_all("Components", ec); fs::remove_all("in", ec); fs::remove_all("out", ec); fs::remove_all("Settings", ec);
+    if (!compileRules(kDefaultRules, "default", gRules)) return 1;
+
+    // --- данные ---
+    Rng rng(seed);
+    const Corpus corpus = makeCorpus(rng, dbEntries);
+    writeComponentDb(rng, corpus, "Components", dbFiles);
+    fs::create_directories("in");
+    const uint64_t bigBytes = writePlacement(rng, corpus, "in/big.csv", rows);
+    std::vector<std::string> batch;
+    uint64_t batchBytes = 0;
+    fs::create_directories("in/batch");
+    for (size_t f = 0; f < files; ++f) {
+        batch.push_back("in/batch/board_" + std::to_string(f) + ".csv");
+        batchBytes += writePlacement(rng, corpus, batch.back(), std::max<size_t>(rows / files, 1));
+    }
+
+    // выборка значений ячеек для микро-замеров
+    std::vector<std::string> cells;
+    uint64_t cellBytes = 0;
+    {
+        CsvReader r;
+        r.open("in/big.csv");
+        while (cells.size() < samples && r.next())
+            if (r.cells().size() > 4) { cells.emplace_back(r.cells()[4]); cellBytes += cells.back().size(); }
+    }
+
+    // --- микро-замеры ---
+    volatile size_t sink = 0;
+    measure("normalizeCell", cells.size(), cellBytes, [&] {
+        for (const auto& c : cells) sink += normalizeCell(c).size();
+    });
+    measure("normalizeCellCached", cells.size(), cellBytes, [&] {
+        std::string out;
+        for (const auto& c : cells) { normalizeCellCached(c, out); sink += out.size(); }
+    });
+    measure("fixCyrillicLetters", cells.size(), cellBytes, [&] {
+        for (const auto& c : cells) sink += fixCyrillicLetters(c).size();
+    });
+    measure("CsvReader (split rows)", rows, bigBytes, [&] {
+        CsvReader r;
+        r.open("in/big.csv");
+        while (r.next()) sink += r.cells().size();
+    });
+
+    // --- база ---
+    uint64_t dbBytes = 0;
+    for (const auto& f : listComponentDbFiles()) dbBytes += fs::file_size(f);
+    measure("buildComponentsIndexMap", corpus.known, dbBytes, [&] { sink += buildComponentsIndexMap().size(); });
+    fs::remove(kSnapshotFile, ec);
+    measure("loadComponentsDb (cold)", corpus.known, dbBytes, [&] { sink += loadComponentsDb().size(); });
+    measure("loadComponentsDb (snapshot)", corpus.known, fs::file_size(kSnapshotFile, ec), [&] { sink += loadComponentsDb().size(); });
+
+    // --- полная конвертация ---
+    const auto dbMap = loadComponentsDb();
+
+    // --- похожие компоненты: запросы — компоненты, которых нет в базе ---
+    SimilarityIndex similar;
+    measure("SimilarityIndex build", dbMap.size(), 0, [&] { similar.build(dbMap); });
+    std::vector<std::string> unknown;
+    for (size_t i = corpus.known; i < corpus.parts.size(); ++i) unknown.push_back(normalizeCell(corpus.parts[i].raw));
+    if (!unknown.empty()) {
+        const size_t queries = std::max<size_t>(unknown.size(), 2000);
+        measure("SimilarityIndex nearest(5)", queries, 0, [&] {
+            for (size_t i = 0; i < queries; ++i) sink += similar.nearest(unknown[i % unknown.size()], kSuggestions).size();
+        });
+    }
+    measure("processFile", rows, bigBytes, [&] {
+        PendingQueue pending;
+        UnknownHandler defer = [&](const std::string& e) -> std::optional<CompInfo> { pending.add(e, "big.csv"); return std::nullopt; };
+        processFile("in/big.csv", "out/big.csv", /*verbose=*/false, dbMap, defer);
+    });
+    measure("processFile pipeline x" + std::to_string(jobCount(SIZE_MAX)), rows, bigBytes, [&] {
+        PendingQueue pending;
+        processFilePipelined("in/big.csv", "out/big.csv", dbMap, [&](const std::string& e) { pending.add(e, "big.csv"); },
+                             jobCount(SIZE_MAX));
+    });
+    {
+        // --columnar: цена сбора столбцов и чтение результата — разбор CSV против board.cols
+        size_t colRows = 0;
+        measure("processFile + columnar", rows, bigBytes, [&] {
+            PendingQueue pending;
+            UnknownHandler defer = [&](const std::string& e) -> std::optional<CompInfo> { pending.add(e, "big.csv"); return std::nullopt; };
+            ColumnarWriter cols("out/big.cols");
+            processFile("in/big.csv", "out/big.csv", /*verbose=*/false, dbMap, defer, nullptr, nullptr, nullptr, &cols);
+            cols.commit();
+            colRows = cols.rows();
+        });
+        measure("read result (CsvReader + strtod)", colRows, fs::file_size("out/big.csv", ec), [&] {
+            CsvReader r;
+            r.open("out/big.csv");
+            while (r.next()) {
+                const auto& c = r.cells();
+                if (c.size() > 2) sink += c[0].size() + (uint64_t)(columnarNumber(c[1]) + columnarNumber(c[2]));
+            }
+        });
+        measure("read result (PlacementColumnsView)", colRows, fs::file_size("out/big.cols", ec), [&] {
+            PlacementColumnsView v;
+            v.open("out/big.cols");
+            for (size_t i = 0; i < v.rows(); ++i) sink += v.designator(i).size() + (uint64_t)(v.x(i) + v.y(i));
+        });
+    }
+    const uint64_t batchRows = (rows / files ? rows / files : 1) * files;
+    {
+        // повторные вызовы встроенного движка на одном небольшом файле (буфер → буфер)
+        std::string input, output;
+        {
+            std::ifstream in(batch[0], std::ios::binary);
+            input.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        }
+        ConversionEngine engine;
+        engine.load("Components");
+        const size_t calls = 4 * files;
+        measure("ConversionEngine x" + std::to_string(calls), batchRows / files * calls, input.size() * calls, [&] {
+            for (size_t i = 0; i < calls; ++i) { engine.convert(input, output); sink += output.size(); }
+        });
+    }
+    measure("convertAll (" + std::to_string(jobCount(files)) + " threads)", batchRows, batchBytes, [&] {
+        PendingQueue pending;
+        std::streambuf* saved = std::cout.rdbuf(nullptr); // без строк прогресса
+        convertBatch(batch, "out/batch", dbMap, pending);
+        std::cout.rdbuf(saved);
+    });
+
+    printJson({ {"rows", std::to_string(rows)}, {"db", std::to_string(dbEntries)}, {"files", std::to_string(files)},
+                {"seed", std::to_string(seed)}, {"threads", std::to_string(jobCount(files))},
+                {"cache_hits", std::to_string(gNormalizeCache.hits())}, {"cache_misses", std::to_string(gNormalizeCache.misses())} });
+    return 0;
+}
+
+} // namespace bench
+
+int main(int argc, char** argv) { return bench::run(argc, argv); }
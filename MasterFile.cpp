@@ -5,26 +5,65 @@
 #include <fstream>
 #include <filesystem>
 #include <algorithm>
-#include <regex>
 #include <cctype>
 #include <limits>
 #include <unordered_map>
 #include <unordered_set>
 #include <optional>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <deque>
+#include <atomic>
+#include <array>
+#include <memory>
+#include <sstream>
+#include <iterator>
+#include <string_view>
+#include <chrono>
+#include <ctime>
+#include <cerrno>
+#include <csignal>
+#include <condition_variable>
+#include <cmath>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#endif
+
+#ifdef _WIN32
+#define NOMINMAX
 #include <conio.h>
 #include <windows.h>
+#else
+#include <termios.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include <poll.h>
+#endif
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
 
 namespace fs = std::filesystem;
 
 // ---------- Settings ----------
 static const std::string kFolder         = "For Conversion";     // входные файлы
-static const std::string kComponentsDir  = "Components";         // база корпусов
+static std::string       kComponentsDir  = "Components";         // база корпусов (можно переопределить -c)
+static const std::string kSettingsDir    = "Settings";
+static const std::string kPendingFile    = kSettingsDir + "/Pending_Review.csv"; // очередь неизвестных (пакетный режим)
+static const std::string kSnapshotFile   = kSettingsDir + "/Components.snapshot"; // бинарный снимок базы
+static bool              gAtomicWrites   = true;  // результат — через временный файл + rename (--no-atomic)
 static std::vector<std::string> kExts    = { /*".xls", ".xlsx", ".csv"*/ };
 // -----------------------------
 
 // Включаем ANSI-последовательности и UTF-8 один раз
 static void enableVTMode() {
+#ifdef _WIN32
     HANDLE hOut = GetStdHandle(STD_OUTPUT_HANDLE);
     if (hOut != INVALID_HANDLE_VALUE) {
         DWORD mode = 0;
@@ -35,10 +74,57 @@ static void enableVTMode() {
     }
     SetConsoleOutputCP(CP_UTF8);
     SetConsoleCP(CP_UTF8);
+#endif
 }
 
 // утилиты
-enum class Key { Up, Down, Enter, Other };
+enum class Key { Up, Down, Enter, Refresh, Backspace, Char, Other };
+
+#ifndef ALTIUM_CONVERTER_NO_MAIN // только для меню и пакетного режима
+// одна клавиша без эха (Windows: _getch, POSIX: termios);
+// typed — для набора текста: печатный байт (UTF-8 — по байту) или Tab возвращается как Key::Char
+static Key readKey(char* typed = nullptr) {
+#ifdef _WIN32
+    int ch = _getch();
+    if (ch == 13) return Key::Enter;
+    if (ch == 8)  return Key::Backspace;
+    if (typed && (ch == '\t' || ch >= 0x20) && ch != 0 && ch != 224) { *typed = (char)ch; return Key::Char; }
+    if (ch == 0 || ch == 224) {
+        int ch2 = _getch();
+        if (ch2 == 72) return Key::Up;      // ↑
+        if (ch2 == 80) return Key::Down;    // ↓
+        if (ch2 == 63) return Key::Refresh; // F5
+    }
+    return Key::Other;
+#else
+    termios saved{};
+    const bool tty = tcgetattr(STDIN_FILENO, &saved) == 0;
+    if (tty) {
+        termios raw = saved;
+        raw.c_lflag &= ~(ICANON | ECHO);
+        raw.c_cc[VMIN] = 1; raw.c_cc[VTIME] = 0;
+        tcsetattr(STDIN_FILENO, TCSANOW, &raw);
+    }
+    auto next = []() -> int { unsigned char c; return ::read(STDIN_FILENO, &c, 1) == 1 ? c : -1; };
+
+    Key k = Key::Other;
+    int ch = next();
+    if (ch == '\n' || ch == '\r') k = Key::Enter;
+    else if (ch == 27 && next() == '[') {   // ESC [ A / ESC [ B / ESC [ 1 5 ~
+        int ch2 = next();
+        if      (ch2 == 'A') k = Key::Up;
+        else if (ch2 == 'B') k = Key::Down;
+        else if (ch2 == '1' && next() == '5' && next() == '~') k = Key::Refresh;
+    }
+    else if (ch < 0) k = Key::Enter; // EOF — не зацикливаться
+    else if (ch == 127 || ch == 8) k = Key::Backspace;
+    else if (typed && (ch == '\t' || ch >= 0x20)) { *typed = (char)ch; k = Key::Char; }
+
+    if (tty) tcsetattr(STDIN_FILENO, TCSANOW, &saved);
+    return k;
+#endif
+}
+#endif
 
 static inline void rstrip_cr(std::string& s) {
     if (!s.empty() && s.back() == '\r') s.pop_back();
@@ -48,9 +134,15 @@ static inline std::string ltrim(const std::string& s) {
     size_t i=0; while(i<s.size() && (s[i]==' '||s[i]=='\t')) ++i; return s.substr(i);
 }
 static inline std::string rtrim(const std::string& s) {
-    if (s.empty()) return s; size_t j=s.size(); while(j>0 && (s[j-1]==' '||s[j-1]=='\t')) --j; return s.substr(0,j);
+    if (s.empty()) return s;
+    size_t j=s.size(); while(j>0 && (s[j-1]==' '||s[j-1]=='\t')) --j; return s.substr(0,j);
 }
 static inline std::string trim(const std::string& s) { return rtrim(ltrim(s)); }
+static inline std::string_view trim_view(std::string_view s) {
+    while (!s.empty() && (s.front()==' '||s.front()=='\t')) s.remove_prefix(1);
+    while (!s.empty() && (s.back()==' '||s.back()=='\t'))   s.remove_suffix(1);
+    return s;
+}
 
 static inline std::string tolower_copy(std::string s) {
     std::transform(s.begin(), s.end(), s.begin(),
@@ -76,412 +168,4014 @@ static bool hasExtension(const fs::path& p, const std::vector<std::string>& exts
     return false;
 }
 
-struct CompInfo {
-    std::string standard;   // 2-й столбец
-    bool to_delete = false; // 3-й столбец == "1"
+// FNV-1a 64: отпечатки содержимого (правила, манифест); h — продолжить с прошлого значения
+static constexpr uint64_t kFnvOffset = 0xcbf29ce484222325ULL;
+static uint64_t fnv1a(const void* data, size_t n, uint64_t h = kFnvOffset) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < n; ++i) { h ^= p[i]; h *= 0x100000001b3ULL; }
+    return h;
+}
+static uint64_t fnv1a(std::string_view s, uint64_t h = kFnvOffset) { return fnv1a(s.data(), s.size(), h); }
+
+// -------- Файл, отображённый в память (только чтение) --------
+class MappedFile {
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile() { close(); }
+
+    bool open(const std::string& path) {
+        close();
+#ifdef _WIN32
+        file_ = CreateFileW(fs::path(path).wstring().c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                            nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file_ == INVALID_HANDLE_VALUE) return false;
+        LARGE_INTEGER sz{};
+        if (!GetFileSizeEx(file_, &sz)) { close(); return false; }
+        size_ = (size_t)sz.QuadPart;
+        if (size_ > 0) {
+            map_ = CreateFileMappingW(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (!map_) { close(); return false; }
+            data_ = (const char*)MapViewOfFile(map_, FILE_MAP_READ, 0, 0, 0);
+            if (!data_) { close(); return false; }
+        }
+#else
+        fd_ = ::open(path.c_str(), O_RDONLY);
+        if (fd_ < 0) return false;
+        struct stat st{};
+        if (fstat(fd_, &st) != 0) { close(); return false; }
+        size_ = (size_t)st.st_size;
+        if (size_ > 0) {
+            void* p = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+            if (p == MAP_FAILED) { close(); return false; }
+            madvise(p, size_, MADV_SEQUENTIAL);
+            data_ = (const char*)p;
+        }
+#endif
+        open_ = true;
+        return true;
+    }
+
+    void close() {
+#ifdef _WIN32
+        if (data_) UnmapViewOfFile(data_);
+        if (map_) CloseHandle(map_);
+        if (file_ != INVALID_HANDLE_VALUE) CloseHandle(file_);
+        map_ = nullptr; file_ = INVALID_HANDLE_VALUE;
+#else
+        if (data_) munmap((void*)data_, size_);
+        if (fd_ >= 0) ::close(fd_);
+        fd_ = -1;
+#endif
+        data_ = nullptr; size_ = 0; open_ = false;
+    }
+
+    bool        is_open() const { return open_; }
+    const char* data()    const { return data_ ? data_ : ""; }
+    size_t      size()    const { return size_; }
+
+private:
+    const char* data_ = nullptr;
+    size_t      size_ = 0;
+    bool        open_ = false;
+#ifdef _WIN32
+    HANDLE file_ = INVALID_HANDLE_VALUE;
+    HANDLE map_  = nullptr;
+#else
+    int fd_ = -1;
+#endif
 };
 
-// перечислить файлы базы
-static std::vector<std::string> listComponentDbFiles() {
-    std::vector<std::string> v;
-    if (!fs::exists(kComponentsDir) || !fs::is_directory(kComponentsDir)) return v;
-    for (auto& e : fs::directory_iterator(kComponentsDir)) {
-        if (fs::is_regular_file(e) && e.path().extension() == ".csv")
-            v.push_back(e.path().string());
+// true — в строке нет байтов >= 0x80 (по 16 байт за шаг через SSE2, иначе по 8 через uint64)
+static bool isAscii(const char* p, size_t n) {
+    size_t i = 0;
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        if (_mm_movemask_epi8(v) != 0) return false;
     }
-    std::sort(v.begin(), v.end());
-    return v;
+#endif
+    for (; i + 8 <= n; i += 8) {
+        uint64_t w; std::memcpy(&w, p + i, 8);
+        if (w & 0x8080808080808080ULL) return false;
+    }
+    for (; i < n; ++i) if ((unsigned char)p[i] & 0x80) return false;
+    return true;
 }
 
-static std::vector<std::string> splitBySemicolon(const std::string& line) {
-    std::vector<std::string> result; result.reserve(8);
-    std::string cell;
-    for (char c : line) {
-        if (c == ';') { result.push_back(cell); cell.clear(); }
-        else          { cell.push_back(c); }
+// -------- Кодировка входных файлов (UTF-8 / CP1251 / UTF-16) --------
+// Altium на русской Windows может выгрузить файл в CP1251 или UTF-16 с BOM. Кодировка
+// определяется по BOM, без него — по первому участку с не-ASCII байтами: нули через байт —
+// UTF-16 без BOM, корректные последовательности UTF-8 — UTF-8, иначе CP1251. UTF-8 читается
+// из отображения как есть (без копии); остальное перекодируется кусками по 64 КБ в UTF-8:
+// ASCII — блоками по 16 байт (SSE2) / 8 байт, CP1251 — по таблице.
+enum class TextEncoding { Utf8, Cp1251, Utf16LE, Utf16BE };
+
+static const char* encodingName(TextEncoding e) {
+    switch (e) {
+        case TextEncoding::Cp1251:  return "CP1251";
+        case TextEncoding::Utf16LE: return "UTF-16LE";
+        case TextEncoding::Utf16BE: return "UTF-16BE";
+        default:                    return "UTF-8";
     }
-    result.push_back(cell);
-    return result;
 }
 
-// разбор строки базы "nonstd;std;del"
-static bool parseDbRow(const std::string& line, std::string& nonstd, CompInfo& info) {
-    auto cells = splitBySemicolon(line);
-    if (cells.size() < 3) return false;
-    nonstd        = trim(cells[0]);
-    info.standard = trim(cells[1]);
-    std::string del = trim(cells[2]);
-    info.to_delete = (del == "1");
-    return !nonstd.empty();
-}
+static constexpr size_t kEncodingSample = 64 * 1024;
 
-// собрать индекс: key = lower(nonstd)
-static std::unordered_map<std::string, CompInfo> buildComponentsIndexMap() {
-    std::unordered_map<std::string, CompInfo> map;
-    auto files = listComponentDbFiles();
-    for (const auto& path : files) {
-        std::ifstream in(path, std::ios::binary);
-        if (!in) continue;
-        std::string line; bool first = true;
-        while (std::getline(in, line)) {
-            rstrip_cr(line);
-            if (first) { first = false; continue; } // пропускаем заголовок
-            std::string nonstd; CompInfo info;
-            if (parseDbRow(line, nonstd, info)) {
-                map[tolower_copy(nonstd)] = info; // последнее определение побеждает
-            }
-        }
+// bom — сколько байт в начале занимает метка (её не перекодировать)
+static TextEncoding detectEncoding(const char* data, size_t n, size_t& bom) {
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+    bom = 0;
+    if (n >= 3 && p[0] == 0xEF && p[1] == 0xBB && p[2] == 0xBF) { bom = 3; return TextEncoding::Utf8; }
+    if (n >= 2 && p[0] == 0xFF && p[1] == 0xFE) { bom = 2; return TextEncoding::Utf16LE; }
+    if (n >= 2 && p[0] == 0xFE && p[1] == 0xFF) { bom = 2; return TextEncoding::Utf16BE; }
+
+    // UTF-16 без BOM: старший байт почти каждого символа — 0x00 (ASCII) или 0x04 (кириллица),
+    // в 8-битном тексте таких байт почти нет
+    const size_t head = std::min(n, kEncodingSample) & ~size_t(1);
+    size_t highEven = 0, highOdd = 0;
+    for (size_t i = 0; i < head; i += 2) {
+        highEven += p[i] == 0 || p[i] == 4;
+        highOdd  += p[i + 1] == 0 || p[i + 1] == 4;
     }
-    return map;
+    const size_t units = head / 2;
+    if (units && highOdd * 4 > units * 3 && highEven * 4 < units) return TextEncoding::Utf16LE;
+    if (units && highEven * 4 > units * 3 && highOdd * 4 < units) return TextEncoding::Utf16BE;
+
+    // первый не-ASCII байт (файлы из одного ASCII — UTF-8) и участок после него
+    size_t start = 0;
+    for (; start < n; start += kEncodingSample)
+        if (!isAscii(data + start, std::min(kEncodingSample, n - start))) break;
+    if (start >= n) return TextEncoding::Utf8;
+    const size_t end = std::min(n, start + kEncodingSample);
+
+    size_t valid = 0, invalid = 0;
+    for (size_t i = start; i < end; ) {
+        const unsigned char c = p[i];
+        if (c < 0x80) { ++i; continue; }
+        size_t len = (c & 0xE0) == 0xC0 ? 2 : (c & 0xF0) == 0xE0 ? 3 : (c & 0xF8) == 0xF0 ? 4 : 0;
+        if (len && i + len > end) break;       // последовательность обрезана краем участка
+        bool ok = len > 0 && c >= 0xC2;        // C0/C1 — избыточная запись
+        for (size_t k = 1; ok && k < len; ++k) ok = (p[i + k] & 0xC0) == 0x80;
+        if (ok) { ++valid; i += len; } else { ++invalid; ++i; }
+    }
+    // пара случайных битых байт в UTF-8 файле не делает его CP1251
+    return invalid == 0 || valid > invalid * 8 ? TextEncoding::Utf8 : TextEncoding::Cp1251;
 }
 
-// аккуратное чтение 1-го столбца (до первого ';')
-static std::string firstCellOfLine(const std::string& line) {
-    size_t p = line.find(';');
-    return trim( (p==std::string::npos)? line : line.substr(0,p) );
+static void appendUtf8(std::string& out, uint32_t cp) {
+    if (cp < 0x80)         out.push_back((char)cp);
+    else if (cp < 0x800)   { out.push_back((char)(0xC0 | (cp >> 6))); out.push_back((char)(0x80 | (cp & 0x3F))); }
+    else if (cp < 0x10000) { out.push_back((char)(0xE0 | (cp >> 12))); out.push_back((char)(0x80 | ((cp >> 6) & 0x3F)));
+                             out.push_back((char)(0x80 | (cp & 0x3F))); }
+    else                   { out.push_back((char)(0xF0 | (cp >> 18))); out.push_back((char)(0x80 | ((cp >> 12) & 0x3F)));
+                             out.push_back((char)(0x80 | ((cp >> 6) & 0x3F))); out.push_back((char)(0x80 | (cp & 0x3F))); }
 }
 
-// построить индекс известных «нестандартных имён» из всех файлов базы
-static std::unordered_set<std::string> buildComponentsIndex() {
-    std::unordered_set<std::string> idx;
-    auto files = listComponentDbFiles();
-    for (const auto& path : files) {
-        std::ifstream in(path, std::ios::binary);
-        if (!in) continue;
-        std::string line; bool first = true;
-        while (std::getline(in, line)) {
-            rstrip_cr(line);
-            if (first) { first = false; continue; } // пропустить заголовок
-            auto nonstd = firstCellOfLine(line);
-            if (!nonstd.empty()) idx.insert(tolower_copy(nonstd));
+// CP1251 0x80..0xFF → UTF-8 (0x98 не определён → U+FFFD)
+struct Cp1251Char { unsigned char len; char bytes[3]; };
+static const std::array<Cp1251Char, 128>& cp1251Table() {
+    static const std::array<Cp1251Char, 128> table = [] {
+        static const uint16_t high[64] = {
+            0x0402, 0x0403, 0x201A, 0x0453, 0x201E, 0x2026, 0x2020, 0x2021, 0x20AC, 0x2030, 0x0409, 0x2039, 0x040A, 0x040C, 0x040B, 0x040F,
+            0x0452, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2013, 0x2014, 0xFFFD, 0x2122, 0x0459, 0x203A, 0x045A, 0x045C, 0x045B, 0x045F,
+            0x00A0, 0x040E, 0x045E, 0x0408, 0x00A4, 0x0490, 0x00A6, 0x00A7, 0x0401, 0x00A9, 0x0404, 0x00AB, 0x00AC, 0x00AD, 0x00AE, 0x0407,
+            0x00B0, 0x00B1, 0x0406, 0x0456, 0x0491, 0x00B5, 0x00B6, 0x00B7, 0x0451, 0x2116, 0x0454, 0x00BB, 0x0458, 0x0405, 0x0455, 0x0457,
+        };
+        std::array<Cp1251Char, 128> t{};
+        for (unsigned i = 0; i < 128; ++i) {
+            const uint32_t cp = i < 64 ? high[i] : 0x0410 + (i - 64); // 0xC0..0xFF — А..я
+            std::string u;
+            appendUtf8(u, cp);
+            t[i].len = (unsigned char)u.size();
+            std::memcpy(t[i].bytes, u.data(), u.size());
         }
-    }
-    return idx;
+        return t;
+    }();
+    return table;
 }
 
-// быстрое да/нет
-static bool askYesNo(const std::string& question, bool defNo = true) {
-    while (true) {
-        std::cout << question << (defNo ? " [y/N]: " : " [Y/n]: ");
-        std::string s; std::getline(std::cin, s);
-        if (s.empty()) return !defNo;
-        char c = (char)std::tolower((unsigned char)s[0]);
-        if (c=='y') return true;
-        if (c=='n') return false;
+// Перекодировщик в UTF-8 по кускам: кусок может оборваться посреди символа UTF-16
+// (нечётный байт, половина суррогатной пары) — остаток переносится в следующий feed().
+class Utf8Transcoder {
+public:
+    explicit Utf8Transcoder(TextEncoding enc) : enc_(enc) {}
+
+    void feed(const char* data, size_t n, std::string& out) {
+        if (enc_ == TextEncoding::Cp1251) { feedCp1251(reinterpret_cast<const unsigned char*>(data), n, out); return; }
+        if (enc_ == TextEncoding::Utf8)   { out.append(data, n); return; }
+        const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+        size_t i = 0;
+        if (hasByte_ && n) { unit(pair(byte_, p[0]), out); hasByte_ = false; i = 1; }
+        i += feedUtf16Ascii(p + i, n - i, out);
+        for (; i + 2 <= n; i += 2) unit(pair(p[i], p[i + 1]), out);
+        if (i < n) { byte_ = p[i]; hasByte_ = true; }
     }
-}
 
+    // конец входа: незавершённый символ → U+FFFD
+    void finish(std::string& out) {
+        if (hasByte_ || high_) appendUtf8(out, 0xFFFD);
+        hasByte_ = false; high_ = 0;
+    }
 
-// запись строки в CSV с ';' и кавычками по необходимости
-static void writeCsvSemicolonRow(std::ofstream& f, const std::vector<std::string>& cells) {
-    for (size_t i = 0; i < cells.size(); ++i) {
-        const std::string& s = cells[i];
-        bool need_quotes = s.find(';')!=std::string::npos || s.find('"')!=std::string::npos ||
-                           s.find('\n')!=std::string::npos || s.find('\r')!=std::string::npos;
-        if (need_quotes) {
-            f << '"';
-            for (char ch : s) f << (ch=='"' ? "\"\"" : std::string(1,ch));
-            f << '"';
-        } else {
-            f << s;
+private:
+    void feedCp1251(const unsigned char* p, size_t n, std::string& out) {
+        const auto& table = cp1251Table();
+        size_t i = 0;
+        while (i < n) {
+            size_t run = i;                                   // ASCII — одним куском
+            while (run + 8 <= n && isAscii(reinterpret_cast<const char*>(p + run), 8)) run += 8;
+            while (run < n && p[run] < 0x80) ++run;
+            out.append(reinterpret_cast<const char*>(p + i), run - i);
+            for (i = run; i < n && p[i] >= 0x80; ++i) {
+                const Cp1251Char& c = table[p[i] - 0x80];
+                out.append(c.bytes, c.len);
+            }
         }
-        if (i + 1 < cells.size()) f << ';';
     }
-    f << "\n";
-}
 
+    uint16_t pair(unsigned char a, unsigned char b) const {
+        return enc_ == TextEncoding::Utf16LE ? (uint16_t)(a | (b << 8)) : (uint16_t)((a << 8) | b);
+    }
 
+    // ASCII в начале куска: по 8 единиц за шаг; возвращает, сколько байт разобрано
+    size_t feedUtf16Ascii(const unsigned char* p, size_t n, std::string& out) {
+        if (high_) return 0;
+        size_t i = 0;
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+        const __m128i mask = _mm_set1_epi16((short)0xFF80), zero = _mm_setzero_si128();
+        while (i + 16 <= n) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+            if (enc_ == TextEncoding::Utf16BE) v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+            if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(v, mask), zero)) != 0xFFFF) break;
+            char buf[16];
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(buf), _mm_packus_epi16(v, v));
+            out.append(buf, 8);
+            i += 16;
+        }
+#endif
+        for (; i + 2 <= n; i += 2) {
+            const uint16_t u = pair(p[i], p[i + 1]);
+            if (u >= 0x80) break;
+            out.push_back((char)u);
+        }
+        return i;
+    }
 
-static std::vector<std::string> listFiles(const std::string& dir){
-    std::vector<std::string> v;
-    if(!fs::exists(dir) || !fs::is_directory(dir)) return v;
-    for (const auto& ent: fs::directory_iterator(dir)) {
-        if (fs::is_regular_file(ent.path()) && hasExtension(ent.path(), kExts))
-            v.push_back(ent.path().string());
+    void unit(uint16_t u, std::string& out) {
+        if (high_) {
+            const uint16_t h = high_;
+            high_ = 0;
+            if (u >= 0xDC00 && u <= 0xDFFF) { appendUtf8(out, 0x10000 + ((uint32_t)(h - 0xD800) << 10) + (u - 0xDC00)); return; }
+            appendUtf8(out, 0xFFFD);                          // одиночная старшая половина
+        }
+        if (u >= 0xD800 && u <= 0xDBFF) { high_ = u; return; }
+        appendUtf8(out, u >= 0xDC00 && u <= 0xDFFF ? 0xFFFD : u);
     }
-    std::sort(v.begin(), v.end());
-    return v;
-}
 
-static void renderMenu(const std::vector<std::string>& items, int selected, const std::string& title) {
-    std::cout << "\x1b[H"; // Home
-    std::cout << title << "\n\n";
-    for (int i = 0; i < (int)items.size(); ++i) {
-        std::cout << "\x1b[K";
-        if (i == selected) std::cout << "\x1b[7m" << (i+1) << ". " << items[i] << "\x1b[0m\n";
-        else               std::cout << (i+1) << ". " << items[i] << "\n";
+    TextEncoding enc_;
+    unsigned char byte_ = 0;
+    bool hasByte_ = false;
+    uint16_t high_ = 0;     // ждёт младшую половину суррогатной пары
+};
+
+// Текстовый файл для разбора: отображение в память и кодировка. Байты отдаются как есть —
+// UTF-8 разбирается прямо из отображения, остальное перекодирует CsvReader скользящим окном
+// (конвейер — каждый свой блок), поэтому копии всего файла в памяти нет.
+class TextFile {
+public:
+    bool open(const std::string& path) {
+        if (!file_.open(path)) return false;
+        encoding_ = detectEncoding(file_.data(), file_.size(), bom_);
+        return true;
     }
-    std::cout << "\n\x1b[KUse Up/Down, Enter. (F5 = refresh)\n";
-    std::cout.flush();
-}
 
-static int selectIndex(const std::vector<std::string>& items, const std::string& title) {
-    std::cout << "\x1b[2J\x1b[H"; // clear once
-    int sel = 0;
-    renderMenu(items, sel, title);
-    while (true) {
-        int ch = _getch();
-        if (ch == 13) return sel; // Enter
-        if (ch == 0 || ch == 224) {
-            int ch2 = _getch();
-            if (ch2 == 72) { sel = (sel - 1 + (int)items.size()) % (int)items.size(); renderMenu(items, sel, title); } // ↑
-            else if (ch2 == 80) { sel = (sel + 1) % (int)items.size(); renderMenu(items, sel, title); }                // ↓
-            else if (ch2 == 63)  return -2; // F5 → обновить список
+    const char*  data()     const { return file_.data(); }  // байты файла (вместе с BOM)
+    size_t       size()     const { return file_.size(); }
+    size_t       bom()      const { return bom_; }          // длина BOM в начале
+    TextEncoding encoding() const { return encoding_; }
+
+    // начало текста в UTF-8 — не больше n байт файла (разделитель и заголовок документации)
+    std::string head(size_t n) const {
+        const size_t len = std::min(n, file_.size() - bom_);
+        Utf8Transcoder t(encoding_);
+        std::string out;
+        t.feed(file_.data() + bom_, len, out);
+        return out;
+    }
+
+private:
+    MappedFile   file_;
+    TextEncoding encoding_ = TextEncoding::Utf8;
+    size_t       bom_ = 0;
+};
+
+// -------- Чтение CSV (';', кавычки по RFC 4180) --------
+// Границы записей без разбора ячеек — те же правила, что у CsvReader::next: запись кончается
+// на '\n' вне поля в кавычках, а поле в кавычках — только если '"' стоит в его начале
+// (кавычка посреди поля, например 2.4", — обычный символ). Запись без таких полей проходится
+// двумя memchr ('\n', затем '"'), поля разбираются только после открывающей кавычки.
+// Возвращает указатель сразу после '\n' записи, начинающейся с p; nullptr — в [p, end)
+// запись не закончилась (или закрывающая кавычка на самом краю: "" ещё не различить).
+static const char* csvRecordEnd(const char* p, const char* end, char delim) {
+    const char* nl = static_cast<const char*>(std::memchr(p, '\n', (size_t)(end - p)));
+    const char* lineEnd = nl ? nl : end;
+    const char* f = p;
+    while ((f = static_cast<const char*>(std::memchr(f, '"', (size_t)(lineEnd - f))))) {
+        if (f == p || f[-1] == delim) break;               // открывающая кавычка поля
+        ++f;
+    }
+    if (!f) return nl ? nl + 1 : nullptr;
+
+    while (true) {                                          // f — начало поля
+        if (f < end && *f == '"') {
+            const char* s = f + 1;
+            while (true) {
+                const char* q = static_cast<const char*>(std::memchr(s, '"', (size_t)(end - s)));
+                if (!q || q + 1 == end) return nullptr;
+                if (q[1] == '"') { s = q + 2; continue; }   // "" внутри поля
+                f = q + 1;
+                break;
+            }
         }
+        while (f < end && *f != delim && *f != '\n') ++f;   // остаток поля (или текст после кавычки)
+        if (f == end) return nullptr;
+        if (*f == '\n') return f + 1;
+        ++f;
     }
 }
 
-static void swallow_utf8_bom(std::ifstream& in) { // пропустить BOM UTF-8
-    if (in.peek() == '\xEF') {
-        char bom[3]; in.read(bom, 3);
-        if (!(bom[0]=='\xEF' && bom[1]=='\xBB' && bom[2]=='\xBF')) {
-            in.clear(); in.seekg(0);
+// то же для байтов UTF-16 (p — на границе символа): '"', разделитель и '\n' — одиночные единицы
+static const char* utf16RecordEnd(const char* p, const char* end, bool bigEndian, char delim) {
+    auto unit = [bigEndian](const char* x) {
+        const unsigned a = (unsigned char)x[0], b = (unsigned char)x[1];
+        return bigEndian ? (a << 8) | b : a | (b << 8);
+    };
+    const unsigned d = (unsigned char)delim;
+    end = p + ((size_t)(end - p) & ~size_t(1));
+    const char* f = p;
+    while (true) {
+        if (f < end && unit(f) == '"') {
+            const char* s = f + 2;
+            while (true) {
+                while (s < end && unit(s) != '"') s += 2;
+                if (s + 2 >= end) return nullptr;
+                if (unit(s + 2) == '"') { s += 4; continue; }
+                f = s + 2;
+                break;
+            }
         }
+        while (f < end && unit(f) != d && unit(f) != '\n') f += 2;
+        if (f == end) return nullptr;
+        if (unit(f) == '\n') return f + 2;
+        f += 2;
     }
 }
 
-// показать меню выбора файла базы (из Components)
-static std::string pickComponentsFile(const std::string& forComponent) {
-    auto files = listComponentDbFiles();
-    if (files.empty()) return "";
-    std::vector<std::string> items;
-    for (auto& f : files) items.push_back(fs::path(f).filename().string());
-    int idx = selectIndex(items, "=== Выберите CSV для: \"" + forComponent + "\" ===");
-    if (idx < 0 || idx >= (int)files.size()) return "";
-    return files[idx];
+// граница записи в байтах файла любой кодировки (CP1251 совпадает с ASCII в '"', ';' и '\n')
+static const char* rawRecordEnd(const char* p, const char* end, TextEncoding enc, char delim) {
+    if (enc == TextEncoding::Utf16LE || enc == TextEncoding::Utf16BE)
+        return utf16RecordEnd(p, end, enc == TextEncoding::Utf16BE, delim);
+    return csvRecordEnd(p, end, delim);
 }
 
-// предложить добавить компонент в выбранную базу
-static std::optional<CompInfo>
-maybeAddComponentToDb(const std::string& nonStandardName,
-                      std::unordered_map<std::string, CompInfo>& idx /* онлайн-обновление */) {
-    std::cout << "Компонент не найден в базе: \"" << nonStandardName << "\"\n";
-    if (!askYesNo("Добавить этот компонент в базу?", true))
-        return std::nullopt;
+// Файл отображается в память, ячейки — string_view прямо в буфер, хранилище строки
+// переиспользуется между вызовами next(). Поле в кавычках может содержать ';', перевод
+// строки и "" (= одна кавычка); только такие поля (с "") собираются в буфер читателя.
+// Без кавычек поведение как у getline + split: строка до '\n', один '\r' в конце срезается.
+// CP1251/UTF-16 перекодируется скользящим окном: кусок по 64 КБ дописывается в окно,
+// разбираются только целые записи, незаконченная переносится в начало окна перед следующим
+// куском — память не зависит от размера файла.
+class CsvReader {
+public:
+    explicit CsvReader(char delim = ';') : delim_(delim) {}
 
-    // выбрать CSV в Components
-    std::string dbPath = pickComponentsFile(nonStandardName);
-    if (dbPath.empty()) {
-        std::cout << "Файл базы не выбран. Пропуск.\n";
-        return std::nullopt;
+    bool open(const std::string& path) {
+        if (!file_.open(path)) return false;
+        resetEncoded(file_.data(), file_.size(), file_.encoding(), file_.bom());
+        return true;
     }
 
-    // ввести стандартное имя (по умолчанию = nonStandardName)
-    std::cout << "Введите стандартное имя (Enter = оставить как есть):\n";
-    std::cout << "  non-std: " << nonStandardName << "\n";
-    std::cout << "  std    : ";
-    std::string stdName;
-    std::getline(std::cin, stdName);
-    if (stdName.empty()) stdName = nonStandardName;
+    // разбирать готовый буфер UTF-8 (должен жить, пока читаются строки);
+    // fileStart = false — кусок из середины файла (граница записи), BOM там не ищется
+    void reset(const char* data, size_t size, bool fileStart = true) {
+        p_ = data; end_ = data + size; row_ = 0; size_ = size;
+        src_ = srcEnd_ = nullptr;
+        transcoder_.reset();
+        encoding_ = TextEncoding::Utf8;
+        if (fileStart && size >= 3 && std::memcmp(data, "\xEF\xBB\xBF", 3) == 0) p_ += 3; // BOM UTF-8
+        safe_ = end_;
+    }
 
-    // спросить флаг удаления
-    bool del = askYesNo("Удалять этот элемент в будущем? (1 = да, 0 = нет)", false);
-    std::string delFlag = del ? "1" : "0";
+    // буфер в кодировке enc (bom — длина её метки в начале); не UTF-8 — через окно.
+    // fileStart — как у reset: BOM UTF-8 после перекодировки срезается только в начале файла
+    void resetEncoded(const char* data, size_t size, TextEncoding enc, size_t bom, bool fileStart = true) {
+        if (enc == TextEncoding::Utf8) { reset(data, size, fileStart); return; }
+        encoding_ = enc;
+        transcoder_.emplace(enc);
+        src_ = data + bom; srcEnd_ = data + size;
+        row_ = 0; size_ = size;
+        window_.clear();
+        p_ = end_ = safe_ = window_.data();
+        fileStart_ = fileStart;
+    }
 
-    // дописать строку в CSV
-    fs::create_directories(fs::path(dbPath).parent_path());
-    std::ofstream out(dbPath, std::ios::app | std::ios::binary);
-    if (!out) {
-        std::cerr << "Не удалось открыть для записи: " << dbPath << "\n";
-        return std::nullopt;
+    bool next() {
+        if (p_ >= safe_ && transcoder_) refill();
+        if (p_ >= end_) return false;
+        ++row_;
+        spans_.clear();
+        scratch_.clear();
+        while (true) {
+            parseField();
+            if (p_ < end_ && *p_ == delim_) { ++p_; continue; }
+            if (p_ < end_) ++p_; // '\n'
+            break;
+        }
+        cells_.resize(spans_.size());
+        for (size_t i = 0; i < spans_.size(); ++i) {
+            const Span& sp = spans_[i];
+            cells_[i] = std::string_view(sp.inScratch ? scratch_.data() + sp.offset : sp.ptr, sp.len);
+        }
+        return true;
     }
-    writeCsvSemicolonRow(out, { nonStandardName, stdName, delFlag });
 
-    // обновить индекс в памяти
-    CompInfo info{ stdName, del };
-    idx[tolower_copy(nonStandardName)] = info;
+    const std::vector<std::string_view>& cells() const { return cells_; }
+    size_t row() const { return row_; } // номер записи (с 1)
+    size_t bytes() const { return size_; } // размер входа
+    TextEncoding encoding() const { return encoding_; }
 
-    std::cout << "Добавлено в: " << fs::path(dbPath).filename().string() << "\n";
-    return info;
-}
+private:
+    struct Span { const char* ptr; size_t offset; size_t len; bool inScratch; };
+
+    // окно: незаконченная запись [p_, end_) — в начало, дописать кусок, пока нет целой записи;
+    // в конце входа окно разбирается до конца (последняя запись может быть без '\n')
+    void refill() {
+        while (transcoder_) {
+            window_.erase(0, (size_t)(p_ - window_.data()));
+            const bool last = src_ == srcEnd_;
+            if (last) {
+                transcoder_->finish(window_);
+                transcoder_.reset();
+            } else {
+                const size_t n = std::min(kEncodingSample, (size_t)(srcEnd_ - src_));
+                transcoder_->feed(src_, n, window_);
+                src_ += n;
+            }
+            p_ = window_.data(); end_ = p_ + window_.size();
+            if (fileStart_) {                                // BOM UTF-8 после перекодировки
+                fileStart_ = false;
+                if (window_.size() >= 3 && std::memcmp(p_, "\xEF\xBB\xBF", 3) == 0) p_ += 3;
+            }
+            if (last) { safe_ = end_; return; }
+            safe_ = p_;
+            while (const char* e = csvRecordEnd(safe_, end_, delim_)) safe_ = e;
+            if (safe_ > p_) return;
+        }
+    }
 
+    void parseField() {
+        if (p_ < end_ && *p_ == '"') { parseQuoted(); return; }
+        const char* b = p_;
+        while (p_ < end_ && *p_ != delim_ && *p_ != '\n') ++p_;
+        size_t len = (size_t)(p_ - b);
+        if ((p_ == end_ || *p_ == '\n') && len > 0 && b[len - 1] == '\r') --len; // CRLF
+        spans_.push_back({ b, 0, len, false });
+    }
 
-// -------- Нормализация домена --------
-static std::string normalizeChipCapacitor(const std::string& in) {
-    using std::regex; using std::regex_replace; using std::regex_constants::icase;
-    std::string s = in;
+    // "..." — закрывающая кавычка перед ';', '\n', "\r\n" или концом файла;
+    // текст после неё до разделителя (некорректный CSV) дописывается к полю как есть
+    void parseQuoted() {
+        ++p_;
+        const char* b = p_;
+        bool copied = false;
+        size_t offset = scratch_.size();
+        while (true) {
+            const char* q = static_cast<const char*>(std::memchr(p_, '"', (size_t)(end_ - p_)));
+            if (!q) { // нет закрывающей кавычки — поле до конца файла
+                if (copied) scratch_.append(p_, end_);
+                else        spans_.push_back({ b, 0, (size_t)(end_ - b), false });
+                p_ = end_;
+                break;
+            }
+            if (q + 1 < end_ && q[1] == '"') { // "" → "
+                if (!copied) { copied = true; scratch_.append(b, q + 1); }
+                else         scratch_.append(p_, q + 1);
+                p_ = q + 2;
+                continue;
+            }
+            if (copied) scratch_.append(p_, q);
+            p_ = q + 1;
+            const bool clean = p_ == end_ || *p_ == delim_ || *p_ == '\n' ||
+                               (*p_ == '\r' && (p_ + 1 == end_ || p_[1] == '\n'));
+            if (!clean) {
+                if (!copied) { copied = true; scratch_.append(b, q); }
+                while (p_ < end_ && *p_ != delim_ && *p_ != '\n') scratch_.push_back(*p_++);
+                if ((p_ == end_ || *p_ == '\n') && scratch_.size() > offset && scratch_.back() == '\r') scratch_.pop_back();
+            } else if (!copied) {
+                spans_.push_back({ b, 0, (size_t)(q - b), false });
+            }
+            if (p_ < end_ && *p_ == '\r') ++p_;
+            break;
+        }
+        if (copied) spans_.push_back({ nullptr, offset, scratch_.size() - offset, true });
+    }
 
-    // 0402|0603|0805|1206|1210 - X5R|X7R - <VOLTAGE...> → корпус-<VOLTAGE...>
-    static const regex re_x5x7(R"(^\s*(0402|0603|0805|1206|1210)\s*-\s*(X5R|X7R)\s*-\s*([0-9]+V-.*)$)", icase);
-    if (std::regex_match(s, re_x5x7)) return regex_replace(s, re_x5x7, "$1-$3");
+    char delim_;
+    TextFile file_;
+    const char* p_   = nullptr;
+    const char* end_ = nullptr;
+    const char* safe_ = nullptr;        // конец последней целой записи в буфере
+    size_t row_ = 0;
+    size_t size_ = 0;
+    TextEncoding encoding_ = TextEncoding::Utf8;
+    std::optional<Utf8Transcoder> transcoder_; // есть, пока вход не UTF-8 и не кончился
+    const char* src_ = nullptr;         // ещё не перекодированные байты
+    const char* srcEnd_ = nullptr;
+    std::string window_;
+    bool fileStart_ = false;
+    std::vector<Span> spans_;
+    std::vector<std::string_view> cells_;
+    std::string scratch_;
+};
 
-    // 0402|... - NP0 - <VOLTAGE...> → корпус-N<VOLTAGE...>
-    static const regex re_np0(R"(^\s*(0402|0603|0805|1206|1210)\s*-\s*NP0\s*-\s*([0-9]+V-.*)$)", icase);
-    if (std::regex_match(s, re_np0)) return regex_replace(s, re_np0, "$1-N$2");
+// -------- Запись CSV --------
+// Quoting::Full    — в кавычки всё, где есть ';', '"', '\r' или '\n' (файлы базы, очередь);
+// Quoting::Minimal — только то, что CsvReader иначе прочитает неверно: ';', '\n' или
+//                    '"' в начале поля (результаты конвертации — как раньше, без лишних кавычек).
+enum class Quoting { Full, Minimal };
 
-    return s;
+// одно поле: решение о кавычках — за один проход по таблице, копирование — кусками
+static void appendCsvField(std::string& buf, std::string_view s, Quoting q, char delim = ';') {
+    const bool full = (q == Quoting::Full);
+    bool needQuotes = !s.empty() && s[0] == '"';
+    for (size_t i = 0; i < s.size() && !needQuotes; ++i) {
+        const char c = s[i];
+        needQuotes = c == delim || c == '\n' || (full && (c == '"' || c == '\r'));
+    }
+    if (!needQuotes) { buf.append(s.data(), s.size()); return; }
+
+    buf.push_back('"');
+    size_t b = 0;
+    for (size_t e; (e = s.find('"', b)) != std::string_view::npos; b = e + 1)
+        buf.append(s.data() + b, e - b + 1).push_back('"'); // " → ""
+    buf.append(s.data() + b, s.size() - b);
+    buf.push_back('"');
 }
 
-// Резисторы: <Pkg>-<Power W>-<Value>-<ppm>[-<tol%>] → убрать -ppm-, tol оставить
-static std::string normalizeResistor(const std::string& in) {
-    using std::regex; using std::smatch; using std::string;
+template <class Cells>
+static void appendCsvRow(std::string& buf, const Cells& cells, Quoting q, char delim = ';') {
+    bool first = true;
+    for (const auto& c : cells) {
+        if (!first) buf.push_back(delim);
+        appendCsvField(buf, std::string_view(c), q, delim);
+        first = false;
+    }
+    buf.push_back('\n');
+}
 
-    static const regex re(
-        R"(^\s*([^- \t]+)\s*-\s*([0-9]+(?:\.[0-9]+)?|[0-9]+/[0-9]+)\s*W\s*-\s*(0R|[0-9]+(?:\.[0-9]+)?[RKM])\s*-\s*[0-9]+\s*ppm(?:\s*-\s*([0-9]+%))?\s*$)",
-        std::regex::icase
-    );
-    smatch m;
-    if (!std::regex_search(in, m, re)) return in;
+// уникальное имя временного файла рядом с path: параллельные процессы не пишут в один .tmp
+static std::string uniqueTempPath(const std::string& path) {
+#ifdef _WIN32
+    const unsigned long pid = GetCurrentProcessId();
+#else
+    const unsigned long pid = (unsigned long)getpid();
+#endif
+    static std::atomic<unsigned> counter{ 0 };
+    return path + "." + std::to_string(pid) + "." + std::to_string(counter++) + ".tmp";
+}
 
-    string out = m[1].str() + "-" + m[2].str() + "W-" + m[3].str();
-    if (m[4].matched && !m[4].str().empty()) out += "-" + m[4].str();
-    return out;
+// дождаться, пока уже записанный и закрытый файл дойдёт до диска (перед rename поверх целевого)
+static bool syncFile(const std::string& path) {
+#ifdef _WIN32
+    HANDLE h = CreateFileW(fs::path(path).wstring().c_str(), GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                           nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (h == INVALID_HANDLE_VALUE) return false;
+    const bool ok = FlushFileBuffers(h) != 0;
+    CloseHandle(h);
+    return ok;
+#else
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    int rc;
+    while ((rc = fsync(fd)) != 0 && errno == EINTR) {}
+    ::close(fd);
+    return rc == 0;
+#endif
 }
 
-// Заменяет визуально похожие кириллические буквы на латинские (UTF-8 → ASCII)
-static std::string fixCyrillicLetters(std::string s) {
-    // Пары: UTF-8 кириллица → ASCII латиница
-    static const std::pair<const char*, const char*> map[] = {
-        // Верхний регистр
-        {u8"А", "A"}, {u8"В", "B"}, {u8"Е", "E"}, {u8"К", "K"},
-        {u8"М", "M"}, {u8"Н", "H"}, {u8"О", "O"}, {u8"Р", "P"},
-        {u8"С", "C"}, {u8"Т", "T"}, {u8"У", "Y"}, {u8"Х", "X"},
-        // Нижний регистр
-        {u8"а", "a"}, {u8"в", "b"}, {u8"е", "e"}, {u8"к", "k"},
-        {u8"м", "m"}, {u8"н", "n"}, {u8"о", "o"}, {u8"р", "p"},
-        {u8"с", "c"}, {u8"т", "t"}, {u8"у", "y"}, {u8"х", "x"}
-    };
+// Буферизованная запись: строки копятся в одном переиспользуемом буфере и уходят
+// в файл блоками. С atomic пишется во временный файл рядом с целевым (uniqueTempPath —
+// у каждого процесса и вызова своё имя), который после fsync переименовывается в целевой
+// только в commit() — ни оборванный запуск, ни сбой питания не оставляют половину
+// результата. Без commit() временный файл удаляется.
+class CsvWriter {
+public:
+    explicit CsvWriter(Quoting q = Quoting::Minimal, char delim = ';', size_t blockSize = 1 << 20)
+        : quoting_(q), delim_(delim), blockSize_(blockSize) {}
+    CsvWriter(const CsvWriter&) = delete;
+    CsvWriter& operator=(const CsvWriter&) = delete;
+    ~CsvWriter() { abandon(); }
+
+    bool open(const std::string& path, bool atomic) {
+        abandon();
+        path_ = path;
+        tmp_ = atomic ? uniqueTempPath(path) : "";
+        out_.open(fs::path(atomic ? tmp_ : path_), std::ios::binary | std::ios::trunc);
+        if (!out_) return false;
+        buf_.clear();
+        buf_.reserve(blockSize_ + blockSize_ / 4);
+        ok_ = true;
+        written_ = 0;
+        return true;
+    }
 
-    for (const auto& p : map) {
-        const char* from = p.first;
-        const char* to   = p.second;
-        const size_t from_len = std::strlen(from);
-        const size_t to_len   = std::strlen(to);
+    template <class Cells>
+    void writeRow(const Cells& cells) {
+        appendCsvRow(buf_, cells, quoting_, delim_);
+        if (buf_.size() >= blockSize_) flush();
+    }
+
+    // уже собранные строки (appendCsvRow с тем же quoting)
+    void writeRaw(std::string_view rows) {
+        buf_.append(rows.data(), rows.size());
+        if (buf_.size() >= blockSize_) flush();
+    }
 
-        size_t pos = 0;
-        while ((pos = s.find(from, pos)) != std::string::npos) {
-            s.replace(pos, from_len, to);
-            pos += to_len;
+    // дописать, закрыть и (для atomic) переименовать; false — ошибка записи
+    bool commit() {
+        if (!out_.is_open()) return false;
+        flush();
+        out_.close();
+        if (!ok_ || out_.fail()) { abandon(); return false; }
+        if (!tmp_.empty()) {
+            if (!syncFile(tmp_)) { abandon(); return false; }
+            std::error_code ec;
+            fs::rename(tmp_, path_, ec);
+            if (ec) { abandon(); return false; }
+            tmp_.clear();
         }
+        return true;
     }
-    return s;
-}
 
-// Глобальная нормализация ячейки (ваши правила)
-static std::string normalizeCell(const std::string& in){
-    std::string s = in;
+    // бросить запись без commit(): временный файл удаляется сразу
+    void abandon() {
+        if (out_.is_open()) out_.close();
+        if (!tmp_.empty()) { std::error_code ec; fs::remove(tmp_, ec); tmp_.clear(); }
+        buf_.clear();
+    }
 
-    // удалить (...) фрагменты
-    static const std::regex paren_re(R"(\([^)]*\))");
-    s = std::regex_replace(s, paren_re, "");
+    uint64_t bytes() const { return written_ + buf_.size(); } // записано (вместе с буфером)
 
-    // ',' → '.'
-    for (char& c : s) if (c == ',') c = '.';
+private:
+    void flush() {
+        if (!buf_.empty() && ok_) ok_ = (bool)out_.write(buf_.data(), (std::streamsize)buf_.size());
+        written_ += buf_.size();
+        buf_.clear();
+    }
 
-    // '?' → '-'
-    for (char& c : s) if (c == '?') c = '-';
+    Quoting     quoting_;
+    char        delim_;
+    size_t      blockSize_;
+    std::string path_, tmp_;
+    std::ofstream out_;
+    std::string buf_;
+    uint64_t    written_ = 0;
+    bool        ok_ = false;
+};
 
-    // убрать пробелы перед тире
-    static const std::regex dash_space_re(R"(\s+-)");
-    s = std::regex_replace(s, dash_space_re, "-");
+struct CompInfo {
+    std::string standard;   // 2-й столбец
+    bool to_delete = false; // 3-й столбец == "1"
+};
 
-    // обрезать всё после '%' (сам знак оставить)
-    if (size_t p = s.find('%'); p != std::string::npos) {
-        s = s.substr(0, p+1);
-    }
+// -------- Чтение XLSX (первый лист) --------
+// XLSX — ZIP с XML внутри. Нужный элемент архива распаковывается потоком (Inflater — свой
+// deflate без zlib, окно 32 КБ + порция 64 КБ), XML разбирается по мере распаковки
+// (XmlStream держит в буфере только незавершённый тег/текст). Общие строки читаются один
+// раз в пул, строки листа отдаются по одной — память ~ размер таблицы общих строк.
 
-    // убрать всё до первой буквы/цифры/%
-    size_t pos = 0;
-    while (pos < s.size()) {
-        unsigned char ch = static_cast<unsigned char>(s[pos]);
-        if (std::isalnum(ch) || ch=='%') break;
-        ++pos;
+class Inflater {
+public:
+    // stored = true — элемент архива без сжатия (метод 0)
+    void reset(const uint8_t* data, size_t size, bool stored) {
+        in_ = data; inSize_ = size; inPos_ = 0; bitBuf_ = 0; bitCnt_ = 0;
+        out_.assign(kWindow + kChunk, 0); outPos_ = 0;
+        state_ = stored ? State::Raw : State::Header;
+        last_ = false; error_ = false; matchLen_ = 0; matchDist_ = 0; storedLeft_ = 0;
     }
-    if (pos > 0) s.erase(0, pos);
 
-    // если в исходнике было LESR — гарантировать его присутствие
-    if (tolower_copy(in).find("lesr") != std::string::npos) {
-        if (tolower_copy(s).find("lesr") == std::string::npos) {
-            if (!s.empty() && s.back()=='%') s += "LESR";
-            else                             s += " LESR";
+    // следующая порция распакованных данных; false — конец потока (или ошибка, см. failed())
+    bool next(std::string_view& chunk) {
+        if (state_ == State::Raw) {                       // без сжатия — весь элемент сразу
+            state_ = State::Done;
+            chunk = std::string_view(reinterpret_cast<const char*>(in_), inSize_);
+            return inSize_ > 0;
+        }
+        if (outPos_ == out_.size()) {                     // сохранить только окно для ссылок назад
+            std::memmove(out_.data(), out_.data() + outPos_ - kWindow, kWindow);
+            outPos_ = kWindow;
         }
+        const size_t start = outPos_;
+        while (!error_ && state_ != State::Done && outPos_ < out_.size()) step();
+        chunk = std::string_view(reinterpret_cast<const char*>(out_.data()) + start, outPos_ - start);
+        return !error_ && !chunk.empty();
     }
+    bool failed() const { return error_; }
 
-    s = trim(s);
+private:
+    static constexpr size_t kWindow = 32768, kChunk = 65536;
+    static constexpr unsigned kFastBits = 9;
 
-    // спец-правила домена
-    s = normalizeChipCapacitor(s);
-    s = normalizeResistor(s);
-    s = fixCyrillicLetters(s);
+    // канонический код Хаффмана: count/symbol для медленного пути + таблица на kFastBits бит
+    struct Huffman {
+        uint16_t count[16] = {};
+        uint16_t symbol[320] = {};
+        uint16_t fast[1u << kFastBits] = {};  // (символ << 4) | длина, 0 — код длиннее kFastBits
 
-    return s;
-}
+        bool build(const uint8_t* lengths, unsigned n) {
+            std::fill(std::begin(count), std::end(count), 0);
+            std::fill(std::begin(fast), std::end(fast), 0);
+            for (unsigned i = 0; i < n; ++i) ++count[lengths[i]];
+            count[0] = 0;
+            int left = 1;
+            for (unsigned len = 1; len < 16; ++len) { left <<= 1; left -= count[len]; if (left < 0) return false; }
+            uint16_t offs[16] = {}, code[16] = {};
+            for (unsigned len = 1; len < 15; ++len) offs[len + 1] = offs[len] + count[len];
+            for (unsigned i = 0; i < n; ++i) if (lengths[i]) symbol[offs[lengths[i]]++] = (uint16_t)i;
+            for (unsigned len = 2; len < 16; ++len) code[len] = (uint16_t)((code[len - 1] + count[len - 1]) << 1);
+            for (unsigned i = 0; i < n; ++i) {
+                const unsigned len = lengths[i];
+                if (!len) continue;
+                const unsigned cd = code[len]++;
+                if (len > kFastBits) continue;
+                unsigned rev = 0;                          // биты кода в потоке идут от старшего
+                for (unsigned b = 0; b < len; ++b) rev |= ((cd >> b) & 1u) << (len - 1 - b);
+                for (unsigned k = rev; k < (1u << kFastBits); k += 1u << len) fast[k] = (uint16_t)((i << 4) | len);
+            }
+            return true;
+        }
+    };
 
-// ---------- Инициализация каталогов и базы корпусов ----------
-int Initialisation() {
-    enableVTMode();
+    enum class State { Header, Stored, Block, Raw, Done };
 
-    // создать каталоги
-    for (const auto& folder : { "Settings", "For Conversion", "Converted", kComponentsDir.c_str(), "Documents" }) {
-        fs::path dir = fs::current_path() / folder;
-        if (!fs::exists(dir)) {
-            if (!fs::create_directory(dir)) {
-                std::cerr << "Failed to create: " << dir << "\n";
-            }
+    void refill() {
+        while (bitCnt_ <= 56 && inPos_ < inSize_) { bitBuf_ |= (uint64_t)in_[inPos_++] << bitCnt_; bitCnt_ += 8; }
+    }
+    unsigned bits(unsigned n) {
+        if (bitCnt_ < n) refill();
+        if (bitCnt_ < n) { error_ = true; return 0; }
+        const unsigned v = (unsigned)(bitBuf_ & ((1ull << n) - 1));
+        bitBuf_ >>= n; bitCnt_ -= n;
+        return v;
+    }
+    int decode(const Huffman& h) {
+        if (bitCnt_ < 15) refill();
+        const uint16_t e = h.fast[bitBuf_ & ((1u << kFastBits) - 1)];
+        if (e && (e & 15) <= bitCnt_) { bitBuf_ >>= (e & 15); bitCnt_ -= (e & 15); return e >> 4; }
+        int code = 0, first = 0, index = 0;              // медленный путь — по биту (как в puff)
+        for (unsigned len = 1; len < 16; ++len) {
+            code |= (int)bits(1);
+            if (error_) return -1;
+            const int count = h.count[len];
+            if (code - count < first) return h.symbol[index + (code - first)];
+            index += count; first += count;
+            first <<= 1; code <<= 1;
         }
+        error_ = true;
+        return -1;
     }
 
-    // файл со списком корпусов
-    const std::string filename = "Settings/Packages.csv";
-    if (!fs::exists(filename)) {
-        std::ofstream file(filename, std::ios::binary);
+    void header() {
+        if (last_) { state_ = State::Done; return; }
+        last_ = bits(1) != 0;
+        switch (bits(2)) {
+            case 0: {                                      // без сжатия: выравнивание, LEN, NLEN
+                const unsigned drop = bitCnt_ % 8;
+                bitBuf_ >>= drop; bitCnt_ -= drop;
+                const unsigned len = bits(16), nlen = bits(16);
+                if (len != (~nlen & 0xFFFFu)) { error_ = true; return; }
+                storedLeft_ = len;
+                state_ = State::Stored;
+                return;
+            }
+            case 1: {                                      // фиксированные коды
+                static const std::pair<Huffman, Huffman> fixed = [] {
+                    uint8_t l[320];
+                    std::pair<Huffman, Huffman> t;
+                    for (unsigned i = 0; i < 288; ++i) l[i] = i < 144 ? 8 : i < 256 ? 9 : i < 280 ? 7 : 8;
+                    t.first.build(l, 288);
+                    for (unsigned i = 0; i < 30; ++i) l[i] = 5;
+                    t.second.build(l, 30);
+                    return t;
+                }();
+                lit_ = fixed.first; dist_ = fixed.second;
+                state_ = State::Block;
+                return;
+            }
+            case 2: dynamicTables(); return;
+            default: error_ = true; return;
+        }
     }
 
-    std::ifstream infile(filename);
-    if (!infile) {
-        std::cerr << "Failed to open " << filename << " for read\n";
-        return 1;
+    void dynamicTables() {
+        static const uint8_t order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+        const unsigned nlen = bits(5) + 257, ndist = bits(5) + 1, ncode = bits(4) + 4;
+        if (error_ || nlen > 286 || ndist > 30) { error_ = true; return; }
+        uint8_t lengths[320] = {};
+        for (unsigned i = 0; i < ncode; ++i) lengths[order[i]] = (uint8_t)bits(3);
+        Huffman lencode;
+        if (!lencode.build(lengths, 19)) { error_ = true; return; }
+        unsigned i = 0;
+        while (i < nlen + ndist && !error_) {
+            int sym = decode(lencode);
+            if (sym < 0) return;
+            if (sym < 16) { lengths[i++] = (uint8_t)sym; continue; }
+            uint8_t len = 0;
+            unsigned rep;
+            if (sym == 16) { if (i == 0) { error_ = true; return; } len = lengths[i - 1]; rep = 3 + bits(2); }
+            else if (sym == 17) rep = 3 + bits(3);
+            else                rep = 11 + bits(7);
+            if (i + rep > nlen + ndist) { error_ = true; return; }
+            while (rep--) lengths[i++] = len;
+        }
+        if (error_ || lengths[256] == 0) { error_ = true; return; }
+        if (!lit_.build(lengths, nlen) || !dist_.build(lengths + nlen, ndist)) { error_ = true; return; }
+        state_ = State::Block;
     }
 
-    const std::string header = "Component_Name_Non_Standart;Component_Name_Standart;Delete_0_or_1\n";
-    std::string line;
-    while (std::getline(infile, line)) {
-        if (line.empty()) continue;
-        std::string fname = kComponentsDir + "/" + sanitize(line) + ".csv";
-        if (fs::exists(fname)) continue;
-        fs::create_directories(fs::path(fname).parent_path());
-        std::ofstream out(fname, std::ios::binary);
-        if (!out) { std::cerr << "Can't create " << fname << "\n"; continue; }
-        out << header;
+    void step() {
+        switch (state_) {
+            case State::Header: header(); return;
+            case State::Stored:
+                while (storedLeft_ && outPos_ < out_.size() && !error_) { out_[outPos_++] = (uint8_t)bits(8); --storedLeft_; }
+                if (!storedLeft_) state_ = State::Header;
+                return;
+            case State::Block: block(); return;
+            default: return;
+        }
     }
-    return 0;
-}
-
-static int processFile(const std::string& pathIn, const std::string& pathOut, bool verbose) {
-    std::ifstream in(pathIn, std::ios::binary);
-    if (!in) { std::cerr << "Не удалось открыть " << pathIn << "\n"; return 1; }
-    swallow_utf8_bom(in);
 
-    fs::create_directories(fs::path(pathOut).parent_path());
-    std::ofstream out(pathOut, std::ios::binary);
-    if (!out) { std::cerr << "Не удалось создать " << pathOut << "\n"; return 1; }
+    void block() {
+        static const uint16_t lbase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                            35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+        static const uint8_t  lext[29]  = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                            3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+        static const uint16_t dbase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+                                            257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+        static const uint8_t  dext[30]  = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+                                            7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+        uint8_t* out = out_.data();
+        const size_t cap = out_.size();
+        while (outPos_ < cap && !error_) {
+            if (matchLen_) {                               // ссылка назад (могла прерваться на конце порции)
+                const size_t n = std::min(matchLen_, cap - outPos_);
+                for (size_t k = 0; k < n; ++k, ++outPos_) out[outPos_] = out[outPos_ - matchDist_];
+                matchLen_ -= n;
+                continue;
+            }
+            const int sym = decode(lit_);
+            if (sym < 0) return;
+            if (sym < 256) { out[outPos_++] = (uint8_t)sym; continue; }
+            if (sym == 256) { state_ = State::Header; return; }
+            if (sym > 285) { error_ = true; return; }
+            matchLen_ = lbase[sym - 257] + bits(lext[sym - 257]);
+            const int ds = decode(dist_);
+            if (ds < 0 || ds > 29) { error_ = true; return; }
+            matchDist_ = dbase[ds] + bits(dext[ds]);
+            if (matchDist_ > outPos_) { error_ = true; return; } // ссылка до начала данных
+        }
+    }
 
-    // индекс базы — один на файл (чтобы не перечитывать для каждой строки)
-    auto dbIndex = buildComponentsIndex();
-    auto dbMap = buildComponentsIndexMap();
+    const uint8_t* in_ = nullptr;
+    size_t inSize_ = 0, inPos_ = 0;
+    uint64_t bitBuf_ = 0;
+    unsigned bitCnt_ = 0;
+    std::vector<uint8_t> out_;
+    size_t outPos_ = 0;
+    State state_ = State::Done;
+    bool last_ = false, error_ = false;
+    size_t storedLeft_ = 0, matchLen_ = 0, matchDist_ = 0;
+    Huffman lit_, dist_;
+};
 
-    std::string line;
-    while (std::getline(in, line)) {
-        rstrip_cr(line);
-        auto cells = splitBySemicolon(line);
+// оглавление ZIP (центральный каталог); ZIP64 и шифрование не поддерживаются
+class ZipArchive {
+public:
+    struct Entry { std::string name; uint16_t method = 0; uint32_t packed = 0, size = 0, offset = 0; };
 
-        // === твоя нормализация "каждый 5-й столбец" ===
-        for (size_t i = 0; i < cells.size(); ++i) {
-            if (((i + 1) % 5) == 0) {
-                cells[i] = normalizeCell(cells[i]);
-            }
+    bool open(const std::string& path) {
+        entries_.clear();
+        if (!file_.open(path)) { std::cerr << "Не удалось открыть " << path << "\n"; return false; }
+        const uint8_t* p = data();
+        const size_t n = file_.size();
+        size_t eocd = std::string::npos;                   // конец центрального каталога — с хвоста
+        for (size_t i = n >= 22 ? n - 22 : 0, stop = n > 65557 ? n - 65557 : 0; n >= 22; --i) {
+            if (u32(p + i) == 0x06054b50) { eocd = i; break; }
+            if (i == stop) break;
         }
-
-        // === правило поворота для C*/R* в 4-м столбце ===
-        if (!cells.empty() && cells.size() > 3 && !cells[0].empty()) {
-            char first = std::toupper(static_cast<unsigned char>(cells[0][0]));
-            if (first == 'C' || first == 'R') {
-                std::string rot = trim(cells[3]);
-                if (rot == "180") cells[3] = "0";
-                else if (rot == "270") cells[3] = "90";
+        if (eocd == std::string::npos) { std::cerr << path << ": не ZIP (XLSX) файл\n"; return false; }
+        const size_t count = u16(p + eocd + 10);
+        size_t at = u32(p + eocd + 16);
+        for (size_t k = 0; k < count; ++k) {
+            if (at + 46 > n || u32(p + at) != 0x02014b50) { std::cerr << path << ": повреждён каталог ZIP\n"; return false; }
+            Entry e;
+            const uint16_t flags = u16(p + at + 8);
+            e.method = u16(p + at + 10);
+            e.packed = u32(p + at + 20);
+            e.size   = u32(p + at + 24);
+            const size_t nameLen = u16(p + at + 28), extra = u16(p + at + 30), comment = u16(p + at + 32);
+            e.offset = u32(p + at + 42);
+            if (at + 46 + nameLen > n) { std::cerr << path << ": повреждён каталог ZIP\n"; return false; }
+            e.name.assign(reinterpret_cast<const char*>(p + at + 46), nameLen);
+            if (flags & 1) { std::cerr << path << ": зашифрованные книги не поддерживаются\n"; return false; }
+            if (e.packed == 0xFFFFFFFFu || e.size == 0xFFFFFFFFu || e.offset == 0xFFFFFFFFu) {
+                std::cerr << path << ": ZIP64 (файлы больше 4 ГБ) не поддерживается\n"; return false;
             }
+            entries_.push_back(std::move(e));
+            at += 46 + nameLen + extra + comment;
         }
-        
+        return true;
+    }
+
+    const Entry* find(const std::string& name) const {
+        for (const auto& e : entries_) if (e.name == name) return &e;
+        return nullptr;
+    }
+
+    // начать распаковку элемента
+    bool read(const Entry& e, Inflater& inf) const {
+        const uint8_t* p = data();
+        const size_t n = file_.size();
+        if ((size_t)e.offset + 30 > n || u32(p + e.offset) != 0x04034b50) return false;
+        const size_t start = (size_t)e.offset + 30 + u16(p + e.offset + 26) + u16(p + e.offset + 28);
+        if (start + e.packed > n || (e.method != 0 && e.method != 8)) return false;
+        inf.reset(p + start, e.packed, e.method == 0);
+        return true;
+    }
+
+    // элемент целиком (маленькие: workbook.xml, .rels)
+    bool readAll(const std::string& name, std::string& out) const {
+        const Entry* e = find(name);
+        Inflater inf;
+        if (!e || !read(*e, inf)) return false;
+        out.clear();
+        std::string_view chunk;
+        while (inf.next(chunk)) out.append(chunk.data(), chunk.size());
+        return !inf.failed() && out.size() == e->size;
+    }
+
+    size_t bytes() const { return file_.size(); }
+
+private:
+    const uint8_t* data() const { return reinterpret_cast<const uint8_t*>(file_.data()); }
+    static uint16_t u16(const uint8_t* p) { return (uint16_t)(p[0] | p[1] << 8); }
+    static uint32_t u32(const uint8_t* p) { return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24; }
+
+    MappedFile file_;
+    std::vector<Entry> entries_;
+};
+
+// Потоковый разбор XML: теги, текст (с раскрытыми сущностями) и конец документа.
+// Имена — без префикса пространства имён; string_view живут до следующего next().
+class XmlStream {
+public:
+    enum class Event { Open, Close, Text, End };
+
+    // источник порций: false — данных больше нет
+    using Source = std::function<bool(std::string_view&)>;
+    explicit XmlStream(Source src) : src_(std::move(src)) {}
+
+    Event next() {
+        while (true) {
+            if (pendingClose_) { pendingClose_ = false; return Event::Close; } // <x/> = Open + Close
+            if (pos_ == buf_.size() && !fill()) return Event::End;
+            if (buf_[pos_] != '<') {
+                size_t lt;
+                while ((lt = buf_.find('<', pos_)) == std::string::npos && fill()) {}
+                if (lt == std::string::npos) lt = buf_.size();
+                text_.clear();
+                decode(std::string_view(buf_).substr(pos_, lt - pos_), text_);
+                pos_ = lt;
+                return Event::Text;
+            }
+            if (startsWith("<![CDATA[")) {
+                const size_t e = find("]]>");
+                text_.assign(buf_, pos_ + 9, e - pos_ - 9);
+                pos_ = std::min(buf_.size(), e + 3);
+                return Event::Text;
+            }
+            if (startsWith("<!--")) { pos_ = std::min(buf_.size(), find("-->") + 3); continue; }
+            const size_t gt = find(">");
+            if (gt == buf_.size()) return Event::End;      // оборванный тег
+            std::string_view tag(buf_.data() + pos_ + 1, gt - pos_ - 1);
+            pos_ = gt + 1;
+            if (tag.empty() || tag[0] == '?' || tag[0] == '!') continue;
+            const bool close = tag[0] == '/';
+            if (close) tag.remove_prefix(1);
+            const bool empty = !close && tag.back() == '/';
+            if (empty) tag.remove_suffix(1);
+            size_t sp = 0;
+            while (sp < tag.size() && !std::isspace((unsigned char)tag[sp])) ++sp;
+            name_ = tag.substr(0, sp);
+            if (size_t colon = name_.find(':'); colon != std::string_view::npos) name_.remove_prefix(colon + 1);
+            attrs_ = tag.substr(sp);
+            pendingClose_ = empty;
+            return close ? Event::Close : Event::Open;
+        }
+    }
+
+    std::string_view name() const { return name_; }
+    const std::string& text() const { return text_; }
+
+    // значение атрибута текущего тега (имя без префикса), пусто — нет
+    std::string attr(std::string_view key) const {
+        std::string_view a = attrs_;
+        while (true) {
+            size_t eq = a.find('=');
+            if (eq == std::string_view::npos || eq + 1 >= a.size()) return {};
+            std::string_view nm = trim_view(a.substr(0, eq));
+            while (!nm.empty() && std::isspace((unsigned char)nm.front())) nm.remove_prefix(1);
+            if (size_t colon = nm.find(':'); colon != std::string_view::npos) nm.remove_prefix(colon + 1);
+            size_t q = eq + 1;
+            while (q < a.size() && a[q] != '"' && a[q] != '\'') ++q;
+            if (q >= a.size()) return {};
+            const size_t end = a.find(a[q], q + 1);
+            if (end == std::string_view::npos) return {};
+            if (nm == key) { std::string v; decode(a.substr(q + 1, end - q - 1), v); return v; }
+            a.remove_prefix(end + 1);
+        }
+    }
+
+    // &amp; &lt; &#NN; &#xHH; и экранирование OOXML _xHHHH_ → UTF-8
+    static void decode(std::string_view s, std::string& out) {
+        auto utf8 = [&](unsigned long cp) {
+            if (cp < 0x80) out.push_back((char)cp);
+            else if (cp < 0x800) { out.push_back((char)(0xC0 | cp >> 6)); out.push_back((char)(0x80 | (cp & 0x3F))); }
+            else if (cp < 0x10000) {
+                out.push_back((char)(0xE0 | cp >> 12)); out.push_back((char)(0x80 | ((cp >> 6) & 0x3F)));
+                out.push_back((char)(0x80 | (cp & 0x3F)));
+            } else {
+                out.push_back((char)(0xF0 | cp >> 18)); out.push_back((char)(0x80 | ((cp >> 12) & 0x3F)));
+                out.push_back((char)(0x80 | ((cp >> 6) & 0x3F))); out.push_back((char)(0x80 | (cp & 0x3F)));
+            }
+        };
+        for (size_t i = 0; i < s.size(); ++i) {
+            const char c = s[i];
+            if (c == '&') {
+                const size_t semi = s.find(';', i);
+                if (semi != std::string_view::npos && semi - i <= 10) {
+                    const std::string_view ent = s.substr(i + 1, semi - i - 1);
+                    unsigned long cp = 0;
+                    if      (ent == "amp")  cp = '&';
+                    else if (ent == "lt")   cp = '<';
+                    else if (ent == "gt")   cp = '>';
+                    else if (ent == "quot") cp = '"';
+                    else if (ent == "apos") cp = '\'';
+                    else if (ent.size() > 1 && ent[0] == '#')
+                        cp = ent[1] == 'x' ? std::strtoul(std::string(ent.substr(2)).c_str(), nullptr, 16)
+                                           : std::strtoul(std::string(ent.substr(1)).c_str(), nullptr, 10);
+                    if (cp && cp <= 0x10FFFF) { utf8(cp); i = semi; continue; }
+                }
+            } else if (c == '_' && i + 6 < s.size() && s[i + 1] == 'x' && s[i + 6] == '_' &&
+                       std::all_of(s.begin() + i + 2, s.begin() + i + 6, [](char h) { return std::isxdigit((unsigned char)h); })) {
+                utf8(std::strtoul(std::string(s.substr(i + 2, 4)).c_str(), nullptr, 16));
+                i += 6;
+                continue;
+            }
+            out.push_back(c);
+        }
+    }
+
+private:
+    // дочитать порцию; разобранное начало буфера отбрасывается
+    bool fill() {
+        std::string_view chunk;
+        if (!src_(chunk)) return false;
+        buf_.erase(0, pos_);
+        pos_ = 0;
+        buf_.append(chunk.data(), chunk.size());
+        return true;
+    }
+    bool startsWith(std::string_view s) {
+        while (buf_.size() - pos_ < s.size() && fill()) {}
+        return std::string_view(buf_).substr(pos_, s.size()) == s;
+    }
+    // позиция s от текущего места (дочитывая), buf_.size() — не найдено
+    size_t find(std::string_view s) {
+        size_t from = pos_;
+        while (true) {
+            const size_t at = buf_.find(s, from);
+            if (at != std::string::npos) return at;
+            const size_t keep = buf_.size() - pos_;
+            if (!fill()) return buf_.size();
+            from = pos_ + (keep >= s.size() ? keep - s.size() + 1 : 0);
+        }
+    }
+
+    Source src_;
+    std::string buf_;
+    size_t pos_ = 0;
+    std::string_view name_, attrs_;
+    std::string text_;
+    bool pendingClose_ = false;
+};
+
+static bool isXlsx(const fs::path& p) { return hasExtension(p, { ".xlsx", ".xlsm" }); }
+static bool isXls(const fs::path& p)  { return hasExtension(p, { ".xls" }); }
+
+// Первый лист книги построчно, интерфейс как у CsvReader: next()/cells()/bytes().
+// Пропущенные ячейки внутри строки — пустые, строки без ячеек не выдаются. Числа — как
+// их хранит Excel, до 15 значащих цифр (формат ячейки/даты не применяется).
+class XlsxReader {
+public:
+    XlsxReader() : xml_([this](std::string_view& c) { return pull(c); }) {}
+    XlsxReader(const XlsxReader&) = delete;            // xml_ читает через this
+    XlsxReader& operator=(const XlsxReader&) = delete;
+
+    bool open(const std::string& path) {
+        path_ = path;
+        if (!zip_.open(path)) return false;
+
+        // лист: первый <sheet> из workbook.xml → его r:id → путь в workbook.xml.rels
+        std::string workbook, rels;
+        if (!zip_.readAll("xl/workbook.xml", workbook)) { std::cerr << path << ": нет xl/workbook.xml\n"; return false; }
+        zip_.readAll("xl/_rels/workbook.xml.rels", rels);
+        std::string sheetRid, sheet = "xl/worksheets/sheet1.xml", shared = "xl/sharedStrings.xml";
+        scanTags(workbook, "sheet", [&](XmlStream& x) { if (sheetRid.empty()) sheetRid = x.attr("id"); });
+        scanTags(rels, "Relationship", [&](XmlStream& x) {
+            std::string target = x.attr("Target");
+            target = target.size() && target[0] == '/' ? target.substr(1) : "xl/" + target;
+            if (x.attr("Id") == sheetRid) sheet = target;
+            const std::string type = x.attr("Type");
+            if (type.size() >= 14 && type.compare(type.size() - 14, 14, "/sharedStrings") == 0) shared = target;
+        });
+
+        if (const ZipArchive::Entry* e = zip_.find(shared)) {
+            if (!zip_.read(*e, inflater_) || !loadSharedStrings()) {
+                std::cerr << path << ": не удалось прочитать " << shared << "\n";
+                return false;
+            }
+        }
+        const ZipArchive::Entry* e = zip_.find(sheet);
+        if (!e || !zip_.read(*e, inflater_)) { std::cerr << path << ": не удалось прочитать " << sheet << "\n"; return false; }
+        return true;
+    }
+
+    bool next() {
+        values_.clear();
+        size_t column = 0;
+        bool inRow = false, inValue = false, inInline = false;
+        std::string type, value;
+        while (true) {
+            switch (xml_.next()) {
+                case XmlStream::Event::End:
+                    if (inflater_.failed()) std::cerr << path_ << ": повреждены данные листа\n";
+                    return false;
+                case XmlStream::Event::Open: {
+                    const std::string_view n = xml_.name();
+                    if (n == "row") { inRow = true; column = 0; break; }
+                    if (!inRow) break;
+                    if (n == "c") {
+                        const std::string ref = xml_.attr("r");
+                        if (!ref.empty() && columnIndex(ref) < kMaxColumns) column = columnIndex(ref);
+                        type = xml_.attr("t");
+                        value.clear();
+                    }
+                    else if (n == "v") inValue = true;
+                    else if (n == "is") inInline = true;
+                    else if (n == "t" && inInline) inValue = true;
+                    break;
+                }
+                case XmlStream::Event::Text:
+                    if (inValue) value += xml_.text();
+                    break;
+                case XmlStream::Event::Close: {
+                    const std::string_view n = xml_.name();
+                    if (n == "v" || n == "t") inValue = false;
+                    else if (n == "is") inInline = false;
+                    else if (n == "c" && inRow && column < kMaxColumns) {
+                        if (values_.size() <= column) values_.resize(column + 1);
+                        values_[column] = cellText(type, value);
+                        ++column;
+                    }
+                    else if (n == "row" && inRow) {
+                        if (values_.empty()) { inRow = false; break; } // пустая строка листа
+                        cells_.resize(values_.size());
+                        for (size_t i = 0; i < values_.size(); ++i)
+                            cells_[i] = values_[i].shared ? strings_.at(values_[i].index) : std::string_view(values_[i].text);
+                        return true;
+                    }
+                    break;
+                }
+            }
+        }
+    }
+
+    const std::vector<std::string_view>& cells() const { return cells_; }
+    size_t bytes() const { return zip_.bytes(); }
+    bool failed() const { return inflater_.failed(); } // next() вернул false из-за повреждённых данных
+
+private:
+    // ячейка: общая строка — ссылкой в пул, остальное — своим текстом
+    struct Value { bool shared = false; size_t index = 0; std::string text; };
+
+    struct StringPool {
+        std::string data;
+        std::vector<size_t> offsets{ 0 };
+        void add(const std::string& s) { data += s; offsets.push_back(data.size()); }
+        size_t size() const { return offsets.size() - 1; }
+        std::string_view at(size_t i) const {
+            return i < size() ? std::string_view(data).substr(offsets[i], offsets[i + 1] - offsets[i]) : std::string_view();
+        }
+    };
+
+    bool pull(std::string_view& chunk) { return inflater_.next(chunk); }
+
+    template <class F>
+    static void scanTags(const std::string& xml, std::string_view tag, F&& f) {
+        bool done = false;
+        XmlStream x([&](std::string_view& c) { if (done) return false; done = true; c = xml; return true; });
+        for (XmlStream::Event ev; (ev = x.next()) != XmlStream::Event::End;)
+            if (ev == XmlStream::Event::Open && x.name() == tag) f(x);
+    }
+
+    // <si> — одна строка: все <t> внутри, кроме фонетических <rPh>
+    bool loadSharedStrings() {
+        XmlStream x([this](std::string_view& c) { return pull(c); });
+        std::string cur;
+        bool inT = false, inPh = false;
+        for (XmlStream::Event ev; (ev = x.next()) != XmlStream::Event::End;) {
+            const std::string_view n = x.name();
+            if (ev == XmlStream::Event::Open) {
+                if (n == "si") cur.clear();
+                else if (n == "t") inT = true;
+                else if (n == "rPh") inPh = true;
+            } else if (ev == XmlStream::Event::Close) {
+                if (n == "si") strings_.add(cur);
+                else if (n == "t") inT = false;
+                else if (n == "rPh") inPh = false;
+            } else if (inT && !inPh) {
+                cur += x.text();
+            }
+        }
+        return !inflater_.failed();
+    }
+
+    static constexpr size_t kMaxColumns = 16384;          // XFD — предел Excel
+
+    // "AB12" → 27 (с 0); kMaxColumns — ссылка неверна
+    static size_t columnIndex(const std::string& ref) {
+        size_t c = 0;
+        for (char ch : ref) {
+            if (ch >= 'A' && ch <= 'Z') c = c * 26 + (size_t)(ch - 'A' + 1);
+            else if (ch >= 'a' && ch <= 'z') c = c * 26 + (size_t)(ch - 'a' + 1);
+            else break;
+            if (c > kMaxColumns) return kMaxColumns;
+        }
+        return c ? c - 1 : kMaxColumns;
+    }
+
+    Value cellText(const std::string& type, const std::string& raw) const {
+        Value v;
+        if (type == "s") { v.shared = true; v.index = std::strtoul(raw.c_str(), nullptr, 10); return v; }
+        if (type == "b") { v.text = raw == "1" ? "TRUE" : "FALSE"; return v; }
+        if (type.empty() || type == "n") {
+            char* end = nullptr;
+            const double d = std::strtod(raw.c_str(), &end);
+            if (!raw.empty() && *end == '\0') {            // 9.4930000000000003 → 9.493
+                char b[40];
+                std::snprintf(b, sizeof b, "%.15g", d);
+                v.text = b;
+                return v;
+            }
+        }
+        v.text = raw;                                      // str, inlineStr, e
+        return v;
+    }
+
+    std::string path_;
+    ZipArchive zip_;
+    Inflater inflater_;
+    XmlStream xml_;
+    StringPool strings_;
+    std::vector<Value> values_;
+    std::vector<std::string_view> cells_;
+};
+
+// Вход processFile: CSV или первый лист XLSX
+class RowReader {
+public:
+    bool open(const std::string& path) {
+        if (isXls(path)) {
+            std::cerr << path << ": формат .xls (Excel 97-2003) не поддерживается — сохраните файл как .xlsx или CSV\n";
+            return false;
+        }
+        xlsx_.reset();                                      // объект можно открывать повторно
+        if (!isXlsx(path)) return csv_.open(path);
+        xlsx_ = std::make_unique<XlsxReader>();
+        return xlsx_->open(path);
+    }
+    bool next() { return xlsx_ ? xlsx_->next() : csv_.next(); }
+    const std::vector<std::string_view>& cells() const { return xlsx_ ? xlsx_->cells() : csv_.cells(); }
+    size_t bytes() const { return xlsx_ ? xlsx_->bytes() : csv_.bytes(); }
+    bool failed() const { return xlsx_ && xlsx_->failed(); }
+    TextEncoding encoding() const { return xlsx_ ? TextEncoding::Utf8 : csv_.encoding(); }
+
+private:
+    CsvReader csv_;
+    std::unique_ptr<XlsxReader> xlsx_;
+};
+
+// результат конвертации всегда CSV: board.xlsx → outDir/board.csv
+static std::string outputPath(const std::string& outDir, const std::string& input) {
+    fs::path name = fs::path(input).filename();
+    if (isXlsx(name) || isXls(name)) name.replace_extension(".csv");
+    return (fs::path(outDir) / name).string();
+}
+
+// -------- База компонентов в памяти --------
+// Ключи (в нижнем регистре, как tolower_copy) и стандартные имена лежат подряд в блоках
+// арены, записи — в одном векторе, поиск — открытая адресация с линейным пробированием
+// по хэшу без учёта регистра. find(string_view) не создаёт строк и не трогает кучу.
+// Блоки арены не перемещаются: string_view из find/forEach живут, пока жива база;
+// указатель из find — до следующего set(). Перезапись ключа дописывает новое значение
+// в арену (старое остаётся до пересборки — база перезаписывается редко).
+class ComponentDb {
+public:
+    struct Ref {
+        std::string_view standard;
+        bool to_delete = false;
+    };
+
+    ComponentDb() = default;
+    ComponentDb(ComponentDb&&) = default;
+    ComponentDb& operator=(ComponentDb&&) = default;
+    ComponentDb(const ComponentDb&) = delete;
+    ComponentDb& operator=(const ComponentDb&) = delete;
+
+    size_t size()  const { return entries_.size(); }
+    bool   empty() const { return entries_.empty(); }
+    // меняется при каждом set(); у разных баз не совпадает (кэши, построенные по базе)
+    uint64_t revision() const { return revision_; }
+
+    void reserve(size_t n) {
+        entries_.reserve(n);
+        if (n * 4 > slots_.size() * 3) rehash(n);
+    }
+
+    const Ref* find(std::string_view name) const {
+        if (slots_.empty()) return nullptr;
+        const uint64_t h = foldHash(name);
+        for (size_t i = (size_t)h & mask_; ; i = (i + 1) & mask_) {
+            const uint32_t s = slots_[i];
+            if (s == 0) return nullptr;
+            const Entry& e = entries_[s - 1];
+            if (e.hash == h && equalFolded(e.key, name)) return &e.info;
+        }
+    }
+    bool contains(std::string_view name) const { return find(name) != nullptr; }
+
+    // добавить или перезаписать (последнее определение побеждает)
+    void set(std::string_view name, std::string_view standard, bool toDelete) {
+        revision_ = nextRevision();
+        if ((entries_.size() + 1) * 4 > slots_.size() * 3) rehash(std::max<size_t>(entries_.size() * 2, 16));
+        const uint64_t h = foldHash(name);
+        size_t i = (size_t)h & mask_;
+        for (; slots_[i] != 0; i = (i + 1) & mask_) {
+            Entry& e = entries_[slots_[i] - 1];
+            if (e.hash == h && equalFolded(e.key, name)) {
+                if (e.info.standard != standard) e.info.standard = store(standard, false);
+                e.info.to_delete = toDelete;
+                return;
+            }
+        }
+        entries_.push_back({ store(name, true), { store(standard, false), toDelete }, h });
+        slots_[i] = (uint32_t)entries_.size();
+    }
+    void set(std::string_view name, const CompInfo& info) { set(name, info.standard, info.to_delete); }
+
+    // f(key, ref) для всех записей в порядке первого добавления
+    template <class F> void forEach(F&& f) const {
+        for (const auto& e : entries_) f(e.key, e.info);
+    }
+
+    // независимая копия (новая версия базы, см. ComponentDbStore); перезаписанные значения не копируются
+    ComponentDb clone() const {
+        ComponentDb c;
+        c.reserve(entries_.size());
+        for (const auto& e : entries_) c.set(e.key, e.info.standard, e.info.to_delete);
+        return c;
+    }
+
+    static char fold(char c) { return (c >= 'A' && c <= 'Z') ? char(c + ('a' - 'A')) : c; }
+
+private:
+    struct Entry { std::string_view key; Ref info; uint64_t hash; };
+    static constexpr size_t kBlockSize = 64 * 1024;
+
+    static uint64_t nextRevision() {
+        static std::atomic<uint64_t> counter{ 0 };
+        return ++counter;
+    }
+
+    static uint64_t foldHash(std::string_view s) {
+        uint64_t h = kFnvOffset;
+        for (char c : s) { h ^= (unsigned char)fold(c); h *= 0x100000001b3ULL; }
+        return h;
+    }
+    static bool equalFolded(std::string_view folded, std::string_view s) {
+        if (folded.size() != s.size()) return false;
+        for (size_t i = 0; i < s.size(); ++i) if (folded[i] != fold(s[i])) return false;
+        return true;
+    }
+
+    std::string_view store(std::string_view s, bool foldCase) {
+        if (s.empty()) return {};
+        if (blocks_.empty() || blockUsed_ + s.size() > blockCap_) {
+            blockCap_ = std::max(kBlockSize, s.size());
+            blocks_.emplace_back(new char[blockCap_]);
+            blockUsed_ = 0;
+        }
+        char* dst = blocks_.back().get() + blockUsed_;
+        if (foldCase) for (size_t i = 0; i < s.size(); ++i) dst[i] = fold(s[i]);
+        else          std::memcpy(dst, s.data(), s.size());
+        blockUsed_ += s.size();
+        return std::string_view(dst, s.size());
+    }
+
+    void rehash(size_t minEntries) {
+        size_t cap = 16;
+        while (cap * 3 < minEntries * 4) cap <<= 1;
+        slots_.assign(cap, 0);
+        mask_ = cap - 1;
+        for (uint32_t n = 0; n < entries_.size(); ++n) {
+            size_t i = (size_t)entries_[n].hash & mask_;
+            while (slots_[i] != 0) i = (i + 1) & mask_;
+            slots_[i] = n + 1;
+        }
+    }
+
+    std::vector<Entry>    entries_;
+    std::vector<uint32_t> slots_;   // индекс в entries_ + 1, 0 = пусто
+    size_t                mask_ = 0;
+    std::vector<std::unique_ptr<char[]>> blocks_;
+    size_t blockUsed_ = 0, blockCap_ = 0;
+    uint64_t revision_ = nextRevision();
+};
+
+// перечислить файлы базы
+static std::vector<std::string> listComponentDbFiles(const std::string& dir = kComponentsDir) {
+    std::vector<std::string> v;
+    if (!fs::exists(dir) || !fs::is_directory(dir)) return v;
+    for (auto& e : fs::directory_iterator(dir)) {
+        if (fs::is_regular_file(e) && e.path().extension() == ".csv")
+            v.push_back(e.path().string());
+    }
+    std::sort(v.begin(), v.end());
+    return v;
+}
+
+// разбор строки базы "nonstd;std;del" (без копий — ячейки живут, пока читается строка)
+static bool parseDbRow(const std::vector<std::string_view>& cells, std::string_view& nonstd,
+                       std::string_view& standard, bool& toDelete) {
+    if (cells.size() < 3) return false;
+    nonstd   = trim_view(cells[0]);
+    standard = trim_view(cells[1]);
+    toDelete = (trim_view(cells[2]) == "1");
+    return !nonstd.empty();
+}
+
+static bool parseDbRow(const std::vector<std::string_view>& cells, std::string& nonstd, CompInfo& info) {
+    std::string_view n, st;
+    if (!parseDbRow(cells, n, st, info.to_delete)) return false;
+    nonstd.assign(n); info.standard.assign(st);
+    return true;
+}
+
+// собрать индекс: key = lower(nonstd)
+static ComponentDb buildComponentsIndexMap(const std::string& dir = kComponentsDir) {
+    ComponentDb map;
+    auto files = listComponentDbFiles(dir);
+    CsvReader reader;
+    for (const auto& path : files) {
+        if (!reader.open(path)) continue;
+        bool first = true;
+        while (reader.next()) {
+            if (first) { first = false; continue; } // пропускаем заголовок
+            std::string_view nonstd, standard; bool del = false;
+            if (parseDbRow(reader.cells(), nonstd, standard, del))
+                map.set(nonstd, standard, del); // последнее определение побеждает
+        }
+    }
+    return map;
+}
+
+// -------- Бинарный снимок базы (Settings/Components.snapshot) --------
+// Снимок хранит уже собранный индекс и «отпечаток» CSV-файлов (имя, размер, mtime).
+// Если отпечаток совпал — CSV не разбираются вовсе. Формат (нативный порядок байт,
+// все смещения от начала файла, выравнивание 8):
+//   SnapshotHeader
+//   SnapshotFile [fileCount]            — отпечатки CSV в порядке listComponentDbFiles()
+//   SnapshotEntry[entryCount]           — key = lower(nonstd), standard, флаги
+//   строки (без завершающих нулей)      — имена файлов, путь к Components, ключи, стандарты
+static constexpr char     kSnapshotMagic[8] = { 'A','C','D','B','S','N','A','P' };
+static constexpr uint32_t kSnapshotVersion  = 1;
+
+struct SnapshotHeader {
+    char     magic[8];
+    uint32_t version;
+    uint32_t fileCount;
+    uint64_t entryCount;
+    uint64_t filesOffset;
+    uint64_t entriesOffset;
+    uint64_t stringsOffset;
+    uint64_t stringsSize;
+    uint64_t totalSize;
+    uint32_t dirOff, dirLen;   // абсолютный путь к Components (смена -c → пересборка)
+};
+struct SnapshotFile  { uint64_t size; int64_t mtime; uint32_t nameOff, nameLen; };
+struct SnapshotEntry { uint32_t keyOff, keyLen, stdOff, stdLen, flags, reserved; };
+static constexpr uint32_t kSnapshotDelete = 1;
+
+struct DbFileStamp { std::string name; uint64_t size = 0; int64_t mtime = 0; };
+
+static std::vector<DbFileStamp> stampComponentDbFiles(const std::vector<std::string>& files) {
+    std::vector<DbFileStamp> v;
+    v.reserve(files.size());
+    for (const auto& f : files) {
+        std::error_code ec;
+        DbFileStamp st;
+        st.name  = fs::path(f).filename().string();
+        st.size  = fs::file_size(f, ec);
+        st.mtime = (int64_t)fs::last_write_time(f, ec).time_since_epoch().count();
+        v.push_back(std::move(st));
+    }
+    return v;
+}
+
+static std::string componentsDirKey(const std::string& dir = kComponentsDir) {
+    std::error_code ec;
+    auto p = fs::weakly_canonical(fs::absolute(dir), ec);
+    return (ec ? fs::path(dir) : p).string();
+}
+
+// -------- Блокировка базы между процессами (Components/Components.lock) --------
+// Несколько копий программы могут работать с одной общей папкой Components. Всё, что
+// пишет в базу (журнал, сжатие), берёт исключительную рекомендательную блокировку файла
+// Components.lock, всё, что читает CSV и журнал целиком, — разделяемую: читатель не увидит
+// недописанную строку журнала, а сжатие не удалит журнал, в который только что дописали.
+// Блокировка — на открытый файл (flock / LockFileEx), поэтому она действует и между
+// потоками одного процесса; вкладывать DbLock друг в друга в одном потоке нельзя.
+// Если файл блокировки не открыть (папка только для чтения), работа идёт без неё.
+static std::string lockPath(const std::string& dir = kComponentsDir) { return (fs::path(dir) / "Components.lock").string(); }
+
+class DbLock {
+public:
+    enum class Mode { Shared, Exclusive };
+
+    explicit DbLock(Mode mode, const std::string& dir = kComponentsDir) {
+        const std::string path = lockPath(dir);
+#ifdef _WIN32
+        h_ = CreateFileW(fs::path(path).wstring().c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                         nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (h_ == INVALID_HANDLE_VALUE) return;
+        OVERLAPPED ov{};
+        if (!LockFileEx(h_, mode == Mode::Exclusive ? LOCKFILE_EXCLUSIVE_LOCK : 0, 0, MAXDWORD, MAXDWORD, &ov)) {
+            CloseHandle(h_);
+            h_ = INVALID_HANDLE_VALUE;
+        }
+#else
+        fd_ = ::open(path.c_str(), O_RDONLY | O_CREAT | O_CLOEXEC, 0644); // только чтение: без событий записи для --watch
+        if (fd_ < 0) return;
+        int rc;
+        while ((rc = flock(fd_, mode == Mode::Exclusive ? LOCK_EX : LOCK_SH)) != 0 && errno == EINTR) {}
+        if (rc != 0) { ::close(fd_); fd_ = -1; }
+#endif
+    }
+    DbLock(const DbLock&) = delete;
+    DbLock& operator=(const DbLock&) = delete;
+
+    ~DbLock() {
+#ifdef _WIN32
+        if (h_ == INVALID_HANDLE_VALUE) return;
+        OVERLAPPED ov{};
+        UnlockFileEx(h_, 0, MAXDWORD, MAXDWORD, &ov);
+        CloseHandle(h_);
+#else
+        if (fd_ < 0) return;
+        flock(fd_, LOCK_UN);
+        ::close(fd_);
+#endif
+    }
+
+    bool held() const {
+#ifdef _WIN32
+        return h_ != INVALID_HANDLE_VALUE;
+#else
+        return fd_ >= 0;
+#endif
+    }
+
+private:
+#ifdef _WIN32
+    HANDLE h_ = INVALID_HANDLE_VALUE;
+#else
+    int fd_ = -1;
+#endif
+};
+
+// true — снимок актуален (в том числе собран для той же папки dir) и загружен в idx
+static bool loadComponentsSnapshot(const std::string& path, const std::vector<DbFileStamp>& stamps,
+                                   ComponentDb& idx, const std::string& dir = kComponentsDir) {
+    MappedFile mf;
+    if (!mf.open(path) || mf.size() < sizeof(SnapshotHeader)) return false;
+    const char* base = mf.data();
+    const auto& h = *reinterpret_cast<const SnapshotHeader*>(base);
+
+    if (std::memcmp(h.magic, kSnapshotMagic, sizeof h.magic) != 0 || h.version != kSnapshotVersion) return false;
+    if (h.totalSize != mf.size() || h.fileCount != stamps.size()) return false;
+    if (h.filesOffset   + (uint64_t)h.fileCount  * sizeof(SnapshotFile)  > h.totalSize) return false;
+    if (h.entriesOffset + h.entryCount * sizeof(SnapshotEntry) > h.totalSize) return false;
+    if (h.stringsOffset + h.stringsSize > h.totalSize) return false;
+
+    const char* strings = base + h.stringsOffset;
+    auto str = [&](uint32_t off, uint32_t len, std::string& out) {
+        if ((uint64_t)off + len > h.stringsSize) return false;
+        out.assign(strings + off, len);
+        return true;
+    };
+
+    std::string tmp;
+    if (!str(h.dirOff, h.dirLen, tmp) || tmp != componentsDirKey(dir)) return false;
+
+    const auto* files = reinterpret_cast<const SnapshotFile*>(base + h.filesOffset);
+    for (uint32_t i = 0; i < h.fileCount; ++i) {
+        if (!str(files[i].nameOff, files[i].nameLen, tmp)) return false;
+        if (tmp != stamps[i].name || files[i].size != stamps[i].size || files[i].mtime != stamps[i].mtime) return false;
+    }
+
+    ComponentDb map;
+    map.reserve((size_t)h.entryCount);
+    const auto* entries = reinterpret_cast<const SnapshotEntry*>(base + h.entriesOffset);
+    auto view = [&](uint32_t off, uint32_t len) { return std::string_view(strings + off, len); };
+    for (uint64_t i = 0; i < h.entryCount; ++i) {
+        const SnapshotEntry& e = entries[i];
+        if ((uint64_t)e.keyOff + e.keyLen > h.stringsSize || (uint64_t)e.stdOff + e.stdLen > h.stringsSize) return false;
+        map.set(view(e.keyOff, e.keyLen), view(e.stdOff, e.stdLen), (e.flags & kSnapshotDelete) != 0);
+    }
+    idx = std::move(map);
+    return true;
+}
+
+// запись через временный файл + rename, чтобы параллельный читатель не увидел половину
+static bool saveComponentsSnapshot(const std::string& path, const std::vector<DbFileStamp>& stamps,
+                                   const ComponentDb& idx, const std::string& dir = kComponentsDir) {
+    std::string strings;
+    auto addStr = [&](std::string_view s, uint32_t& off, uint32_t& len) {
+        off = (uint32_t)strings.size(); len = (uint32_t)s.size();
+        strings += s;
+    };
+    auto align8 = [](uint64_t x) { return (x + 7) & ~uint64_t(7); };
+
+    SnapshotHeader h{};
+    std::memcpy(h.magic, kSnapshotMagic, sizeof h.magic);
+    h.version    = kSnapshotVersion;
+    h.fileCount  = (uint32_t)stamps.size();
+    h.entryCount = idx.size();
+    addStr(componentsDirKey(dir), h.dirOff, h.dirLen);
+
+    std::vector<SnapshotFile> files(stamps.size());
+    for (size_t i = 0; i < stamps.size(); ++i) {
+        files[i].size  = stamps[i].size;
+        files[i].mtime = stamps[i].mtime;
+        addStr(stamps[i].name, files[i].nameOff, files[i].nameLen);
+    }
+    std::vector<SnapshotEntry> entries;
+    entries.reserve(idx.size());
+    idx.forEach([&](std::string_view key, const ComponentDb::Ref& info) {
+        SnapshotEntry e{};
+        addStr(key, e.keyOff, e.keyLen);
+        addStr(info.standard, e.stdOff, e.stdLen);
+        e.flags = info.to_delete ? kSnapshotDelete : 0;
+        entries.push_back(e);
+    });
+    if (strings.size() > UINT32_MAX) return false;
+
+    h.filesOffset   = align8(sizeof h);
+    h.entriesOffset = align8(h.filesOffset + files.size() * sizeof(SnapshotFile));
+    h.stringsOffset = align8(h.entriesOffset + entries.size() * sizeof(SnapshotEntry));
+    h.stringsSize   = strings.size();
+    h.totalSize     = h.stringsOffset + h.stringsSize;
+
+    std::string buf((size_t)h.totalSize, '\0');
+    std::memcpy(&buf[0], &h, sizeof h);
+    if (!files.empty())   std::memcpy(&buf[(size_t)h.filesOffset],   files.data(),   files.size()   * sizeof(SnapshotFile));
+    if (!entries.empty()) std::memcpy(&buf[(size_t)h.entriesOffset], entries.data(), entries.size() * sizeof(SnapshotEntry));
+    if (!strings.empty()) std::memcpy(&buf[(size_t)h.stringsOffset], strings.data(), strings.size());
+
+    std::error_code ec;
+    fs::create_directories(fs::path(path).parent_path(), ec);
+    const std::string tmp = uniqueTempPath(path);
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        if (!out || !out.write(buf.data(), (std::streamsize)buf.size())) { out.close(); fs::remove(tmp, ec); return false; }
+    }
+    fs::rename(tmp, path, ec);
+    if (ec) { fs::remove(tmp, ec); return false; }
+    return true;
+}
+
+// -------- Журнал изменений базы (Components/Components.journal) --------
+// Новые компоненты не дописываются в CSV базы по одному, а копятся в памяти и в конце
+// сеанса одной записью (с fsync) уходят в журнал: "nonstd;std;del;файл базы".
+// При загрузке журнал применяется поверх CSV (его записи новее всех); сжатие
+// (compactComponentsDb) переносит журнал в CSV и очищает его. Запись — под DbLock.
+static const std::vector<std::string> kDbColumns = { "Component_Name_Non_Standart", "Component_Name_Standart", "Delete_0_or_1" };
+static constexpr size_t kJournalCompactRows = 1000; // после стольких записей журнал сжимается сам
+
+static std::string journalPath(const std::string& dir = kComponentsDir) { return (fs::path(dir) / "Components.journal").string(); }
+
+struct JournalEntry { std::string nonstd; CompInfo info; std::string file; };
+
+// дописать data в конец файла и дождаться, пока она дойдёт до диска
+static bool appendDurable(const std::string& path, const std::string& data) {
+#ifdef _WIN32
+    HANDLE h = CreateFileW(fs::path(path).wstring().c_str(), FILE_APPEND_DATA, FILE_SHARE_READ, nullptr,
+                           OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (h == INVALID_HANDLE_VALUE) return false;
+    DWORD written = 0;
+    bool ok = WriteFile(h, data.data(), (DWORD)data.size(), &written, nullptr) && written == data.size();
+    ok = FlushFileBuffers(h) && ok;
+    CloseHandle(h);
+    return ok;
+#else
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd < 0) return false;
+    bool ok = true;
+    for (size_t off = 0; ok && off < data.size(); ) {
+        ssize_t n = ::write(fd, data.data() + off, data.size() - off);
+        if (n < 0 && errno == EINTR) continue;
+        ok = n > 0;
+        if (ok) off += (size_t)n;
+    }
+    ok = fsync(fd) == 0 && ok;
+    ::close(fd);
+    return ok;
+#endif
+}
+
+static std::vector<JournalEntry> readJournal(const std::string& path) {
+    std::vector<JournalEntry> v;
+    CsvReader in;
+    if (!in.open(path)) return v;
+    bool first = true;
+    while (in.next()) {
+        if (first) { first = false; continue; } // заголовок
+        JournalEntry e;
+        if (!parseDbRow(in.cells(), e.nonstd, e.info) || in.cells().size() < 4) continue;
+        e.file = std::string(trim_view(in.cells()[3]));
+        v.push_back(std::move(e));
+    }
+    return v;
+}
+
+class DbJournal {
+public:
+    void add(JournalEntry e) { pending_.push_back(std::move(e)); }
+    size_t pending() const { return pending_.size(); }
+
+    // всё накопленное — одной записью и одним fsync в журнал базы из папки dir
+    bool flush(const std::string& dir = kComponentsDir) {
+        if (pending_.empty()) return true;
+        DbLock lock(DbLock::Mode::Exclusive, dir);
+        return flushLocked(dir);
+    }
+
+    // то же, когда исключительная блокировка уже взята (сжатие)
+    bool flushLocked(const std::string& dir = kComponentsDir) {
+        if (pending_.empty()) return true;
+        const std::string path = journalPath(dir);
+        std::string buf;
+        std::error_code ec;
+        if (!fs::exists(path, ec) || fs::file_size(path, ec) == 0) {
+            std::vector<std::string> header = kDbColumns;
+            header.push_back("Components_File");
+            appendCsvRow(buf, header, Quoting::Full);
+        }
+        for (const auto& e : pending_)
+            appendCsvRow(buf, std::vector<std::string>{ e.nonstd, e.info.standard, e.info.to_delete ? "1" : "0", e.file },
+                         Quoting::Full);
+        fs::create_directories(fs::path(path).parent_path(), ec);
+        if (!appendDurable(path, buf)) {
+            std::cerr << "Не удалось записать журнал базы: " << path << "\n";
+            return false;
+        }
+        pending_.clear();
+        return true;
+    }
+
+private:
+    std::vector<JournalEntry> pending_;
+};
+
+static DbJournal gDbJournal;
+
+#ifndef ALTIUM_CONVERTER_NO_MAIN // только для меню и пакетного режима
+// -------- Сжатие базы --------
+// Каждый CSV в Components переписывается отсортированным по ключу и без повторов
+// (внутри файла остаётся последнее определение — как и при загрузке), записи журнала
+// переносятся в свои файлы. Один ключ с разными значениями в разных файлах — конфликт:
+// он не исправляется, а печатается (при загрузке действует последний файл по алфавиту).
+// Ключ из журнала убирается из остальных файлов — журнал новее всего.
+struct CompactReport {
+    size_t files = 0, rowsBefore = 0, rowsAfter = 0, duplicates = 0, invalid = 0, journal = 0;
+    std::vector<std::string> conflicts;
+    std::vector<std::string> renamed;   // записи журнала, чей файл базы пришлось поправить
+};
+
+// имя файла базы, который загрузит listComponentDbFiles: "имя.csv" без папок
+static bool isComponentDbFileName(const std::string& name) {
+    return name.find_first_of("/\\:") == std::string::npos && fs::path(name).extension() == ".csv";
+}
+
+// файл базы для записи журнала: пусто → Journal.csv, "Lib_1" → "Lib_1.csv"; прочее
+// (чужое расширение, путь) — тоже в Journal.csv, чтобы запись не пропала из базы
+static std::string journalTargetFile(const std::string& file) {
+    if (file.empty()) return "Journal.csv";
+    if (isComponentDbFileName(file)) return file;
+    if (fs::path(file).extension().empty() && isComponentDbFileName(file + ".csv")) return file + ".csv";
+    return "Journal.csv";
+}
+
+static bool compactComponentsDb(CompactReport& rep) {
+    DbLock lock(DbLock::Mode::Exclusive); // журнал не должен пополниться между чтением и удалением
+    if (!gDbJournal.flushLocked()) return false;
+    const std::string jPath = journalPath();
+    const auto journal = readJournal(jPath);
+
+    struct Row { std::string name; CompInfo info; };
+    struct DbFile { std::string path; std::vector<std::string> header; std::unordered_map<std::string, Row> rows; };
+    std::vector<DbFile> dbs;
+    CsvReader reader;
+    for (const auto& path : listComponentDbFiles()) {
+        if (!reader.open(path)) { std::cerr << "Не удалось открыть " << path << "\n"; return false; }
+        DbFile db;
+        db.path = path;
+        bool first = true;
+        while (reader.next()) {
+            const auto& cells = reader.cells();
+            if (first) { first = false; for (auto c : cells) db.header.emplace_back(c); continue; }
+            ++rep.rowsBefore;
+            Row r;
+            if (!parseDbRow(cells, r.name, r.info)) { ++rep.invalid; continue; }
+            auto [it, inserted] = db.rows.insert_or_assign(tolower_copy(r.name), std::move(r));
+            if (!inserted) ++rep.duplicates;
+        }
+        dbs.push_back(std::move(db));
+    }
+
+    for (const auto& e : journal) {
+        const std::string key = tolower_copy(e.nonstd);
+        const std::string file = journalTargetFile(e.file);
+        if (!e.file.empty() && file != e.file) rep.renamed.push_back(e.nonstd + ": \"" + e.file + "\" → " + file);
+        auto target = std::find_if(dbs.begin(), dbs.end(),
+                                   [&](const DbFile& d) { return fs::path(d.path).filename().string() == file; });
+        if (target == dbs.end()) {
+            DbFile db;
+            db.path = (fs::path(kComponentsDir) / file).string();
+            dbs.push_back(std::move(db));
+            target = std::prev(dbs.end());
+        }
+        for (auto& d : dbs) if (&d != &*target) d.rows.erase(key);
+        target->rows[key] = Row{ e.nonstd, e.info };
+        ++rep.journal;
+    }
+    std::sort(dbs.begin(), dbs.end(), [](const DbFile& a, const DbFile& b) { return a.path < b.path; });
+
+    // конфликты между файлами
+    std::unordered_map<std::string, std::vector<size_t>> where;
+    for (size_t i = 0; i < dbs.size(); ++i)
+        for (const auto& kv : dbs[i].rows) where[kv.first].push_back(i);
+    std::vector<std::string> keys;
+    for (const auto& kv : where) if (kv.second.size() > 1) keys.push_back(kv.first);
+    std::sort(keys.begin(), keys.end());
+    for (const auto& k : keys) {
+        const auto& ids = where[k];
+        bool differ = false;
+        const Row& last = dbs[ids.back()].rows[k];
+        for (size_t i : ids) {
+            const Row& r = dbs[i].rows[k];
+            differ |= r.info.standard != last.info.standard || r.info.to_delete != last.info.to_delete;
+        }
+        if (!differ) continue;
+        std::string msg = last.name + ":";
+        for (size_t i : ids) {
+            const Row& r = dbs[i].rows[k];
+            msg += " " + fs::path(dbs[i].path).filename().string() + " → " + (r.info.to_delete ? "[удалять]" : r.info.standard) + ";";
+        }
+        rep.conflicts.push_back(msg + " действует " + fs::path(dbs[ids.back()].path).filename().string());
+    }
+
+    for (auto& db : dbs) {
+        std::vector<const std::pair<const std::string, Row>*> rows;
+        rows.reserve(db.rows.size());
+        for (const auto& kv : db.rows) rows.push_back(&kv);
+        std::sort(rows.begin(), rows.end(), [](auto a, auto b) { return a->first < b->first; });
+
+        CsvWriter out(Quoting::Full);
+        fs::create_directories(fs::path(db.path).parent_path());
+        if (!out.open(db.path, /*atomic=*/true)) { std::cerr << "Не удалось создать " << db.path << "\n"; return false; }
+        out.writeRow(db.header.empty() ? kDbColumns : db.header);
+        for (const auto* kv : rows)
+            out.writeRow(std::vector<std::string>{ kv->second.name, kv->second.info.standard, kv->second.info.to_delete ? "1" : "0" });
+        if (!out.commit()) { std::cerr << "Ошибка записи " << db.path << "\n"; return false; }
+        rep.rowsAfter += rows.size();
+        ++rep.files;
+    }
+
+    std::error_code ec;
+    fs::remove(jPath, ec); // всё уже в CSV
+    return true;
+}
+
+static void printCompactReport(const CompactReport& rep) {
+    std::cout << "Сжатие базы: файлов " << rep.files << ", строк " << rep.rowsBefore << " → " << rep.rowsAfter
+              << " (повторов: " << rep.duplicates << ", некорректных: " << rep.invalid
+              << ", из журнала: " << rep.journal << ")\n";
+    if (!rep.conflicts.empty()) {
+        std::cout << "Конфликты между файлами (" << rep.conflicts.size() << "):\n";
+        for (const auto& c : rep.conflicts) std::cout << "  " << c << "\n";
+    }
+    if (!rep.renamed.empty()) {
+        std::cout << "Записи журнала с неподходящим именем файла базы (" << rep.renamed.size() << "):\n";
+        for (const auto& r : rep.renamed) std::cout << "  " << r << "\n";
+    }
+}
+
+// конец сеанса: записать журнал; если он разросся — сжать базу
+static bool finishDbSession() {
+    if (!gDbJournal.flush()) return false;
+    size_t rows;
+    {
+        DbLock lock(DbLock::Mode::Shared);
+        rows = readJournal(journalPath()).size();
+    }
+    if (rows < kJournalCompactRows) return true;
+    CompactReport rep;
+    if (!compactComponentsDb(rep)) return false;
+    printCompactReport(rep);
+    return true;
+}
+#endif
+
+// база компонентов из папки dir — один раз за сеанс: снимок, если актуален, иначе разбор CSV
+// + новый снимок (snapshotFile пуст — без снимка, только CSV); поверх — журнал.
+// Под разделяемой DbLock: запись журнала или сжатие в другом процессе ждут.
+static ComponentDb loadComponentsDb(const std::string& dir = kComponentsDir, const std::string& snapshotFile = kSnapshotFile) {
+    DbLock lock(DbLock::Mode::Shared, dir);
+    ComponentDb map;
+    if (snapshotFile.empty()) {
+        map = buildComponentsIndexMap(dir);
+    } else {
+        const auto stamps = stampComponentDbFiles(listComponentDbFiles(dir));
+        if (!loadComponentsSnapshot(snapshotFile, stamps, map, dir)) {
+            map = buildComponentsIndexMap(dir);
+            if (!saveComponentsSnapshot(snapshotFile, stamps, map, dir))
+                std::cerr << "Не удалось сохранить снимок базы: " << snapshotFile << "\n";
+        }
+    }
+    for (const auto& e : readJournal(journalPath(dir))) // журнал — поверх CSV
+        map.set(e.nonstd, e.info);
+    return map;
+}
+
+// -------- Версии базы в памяти --------
+// Опубликованная база не меняется: читатель берёт current() (атомарная копия shared_ptr,
+// без ожидания писателей) и работает с этой версией до конца файла/пачки. Правка делает
+// копию, меняет её и публикует целиком — другие потоки видят либо старую версию, либо
+// новую со всеми правками. Перечитанная с диска база публикуется так же (publish).
+class ComponentDbStore {
+public:
+    explicit ComponentDbStore(ComponentDb db = ComponentDb())
+        : current_(std::make_shared<const ComponentDb>(std::move(db))) {}
+    ComponentDbStore(const ComponentDbStore&) = delete;
+    ComponentDbStore& operator=(const ComponentDbStore&) = delete;
+
+    std::shared_ptr<const ComponentDb> current() const { return std::atomic_load(&current_); }
+
+    void publish(std::shared_ptr<const ComponentDb> db) {
+        std::lock_guard<std::mutex> lk(writeMutex_);
+        std::atomic_store(&current_, std::move(db));
+    }
+
+    // change(копия текущей версии) → новая версия; правки одного писателя не теряются
+    void update(const std::function<void(ComponentDb&)>& change) {
+        std::lock_guard<std::mutex> lk(writeMutex_);
+        auto next = std::make_shared<ComponentDb>(std::atomic_load(&current_)->clone());
+        change(*next);
+        std::atomic_store(&current_, std::shared_ptr<const ComponentDb>(std::move(next)));
+    }
+
+private:
+    std::shared_ptr<const ComponentDb> current_;
+    std::mutex writeMutex_;             // только между писателями
+};
+
+// -------- Похожие компоненты (нечёткий поиск по базе) --------
+// Индекс триграмм по ключам базы: для каждой триграммы — id ключей, где она есть.
+// Запрос считает общие триграммы начиная с самых редких (частые вроде "-10" пропускаются,
+// когда бюджет просмотренных id исчерпан), затем лучшие по числу общих триграмм
+// кандидаты ранжируются по расстоянию Левенштейна. Варианты с одинаковым стандартным
+// именем схлопываются в один.
+class SimilarityIndex {
+public:
+    struct Match { std::string key; CompInfo info; unsigned distance; };
+
+    void build(const ComponentDb& dbMap) {
+        keys_.clear(); infos_.clear(); postings_.clear();
+        keys_.reserve(dbMap.size()); infos_.reserve(dbMap.size());
+        dbMap.forEach([&](std::string_view key, const ComponentDb::Ref& info) {
+            keys_.emplace_back(key);
+            infos_.push_back(CompInfo{ std::string(info.standard), info.to_delete });
+        });
+        // порядок ключей не зависит от хэш-таблицы → одинаковые подсказки от запуска к запуску
+        std::vector<uint32_t> order(keys_.size());
+        for (uint32_t i = 0; i < order.size(); ++i) order[i] = i;
+        std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return keys_[a] < keys_[b]; });
+        std::vector<std::string> keys; std::vector<CompInfo> infos;
+        keys.reserve(order.size()); infos.reserve(order.size());
+        for (uint32_t i : order) { keys.push_back(std::move(keys_[i])); infos.push_back(std::move(infos_[i])); }
+        keys_.swap(keys); infos_.swap(infos);
+
+        std::vector<uint32_t> grams;
+        for (uint32_t id = 0; id < keys_.size(); ++id) {
+            trigrams(keys_[id], grams);
+            for (uint32_t g : grams) postings_[g].push_back(id);
+        }
+    }
+
+    size_t size() const { return keys_.size(); }
+
+    std::vector<Match> nearest(const std::string& query, size_t k) const {
+        std::vector<Match> out;
+        if (keys_.empty() || k == 0) return out;
+        const std::string q = tolower_copy(query);
+
+        std::vector<uint32_t> grams;
+        trigrams(q, grams);
+        std::vector<const std::vector<uint32_t>*> lists;
+        for (uint32_t g : grams) {
+            auto it = postings_.find(g);
+            if (it != postings_.end()) lists.push_back(&it->second);
+        }
+        std::sort(lists.begin(), lists.end(), [](auto a, auto b) { return a->size() < b->size(); });
+
+        std::vector<uint16_t> counts(keys_.size(), 0);
+        std::vector<uint32_t> touched;
+        size_t visited = 0;
+        for (size_t i = 0; i < lists.size(); ++i) {
+            if (i >= kMinGrams && visited + lists[i]->size() > kVisitBudget) break;
+            visited += lists[i]->size();
+            for (uint32_t id : *lists[i])
+                if (counts[id]++ == 0) touched.push_back(id);
+        }
+
+        // лучшие по общим триграммам (при равенстве — ближе по длине), затем — по расстоянию
+        auto byOverlap = [&](uint32_t a, uint32_t b) {
+            if (counts[a] != counts[b]) return counts[a] > counts[b];
+            const size_t da = lengthGap(keys_[a].size(), q.size()), db = lengthGap(keys_[b].size(), q.size());
+            return da != db ? da < db : a < b;
+        };
+        if (touched.size() > kRerank) {
+            // порог по числу общих триграмм: гистограмма вместо сортировки всех кандидатов
+            std::vector<size_t> hist(grams.size() + 2, 0);
+            for (uint32_t id : touched) ++hist[std::min<size_t>(counts[id], grams.size() + 1)];
+            size_t threshold = hist.size() - 1, above = hist[threshold];
+            while (threshold > 1 && above < kRerank) above += hist[--threshold];
+            touched.erase(std::remove_if(touched.begin(), touched.end(),
+                                         [&](uint32_t id) { return counts[id] < threshold; }), touched.end());
+            if (touched.size() > kRerank) {
+                std::nth_element(touched.begin(), touched.begin() + kRerank, touched.end(), byOverlap);
+                touched.resize(kRerank);
+            }
+        }
+
+        std::vector<std::pair<unsigned, uint32_t>> ranked;
+        ranked.reserve(touched.size());
+        std::vector<unsigned> row;
+        for (uint32_t id : touched) ranked.emplace_back(editDistance(q, keys_[id], row), id);
+        std::sort(ranked.begin(), ranked.end());
+
+        for (const auto& [dist, id] : ranked) {
+            const CompInfo& info = infos_[id];
+            const bool dup = std::any_of(out.begin(), out.end(), [&](const Match& m) {
+                return m.info.to_delete == info.to_delete && m.info.standard == info.standard;
+            });
+            if (dup) continue;
+            out.push_back({ keys_[id], info, dist });
+            if (out.size() == k) break;
+        }
+        return out;
+    }
+
+private:
+    static constexpr size_t kMinGrams    = 3;       // столько самых редких триграмм — всегда
+    static constexpr size_t kVisitBudget = 1 << 14; // дальше частые триграммы не просматриваются
+    static constexpr size_t kRerank      = 64;      // кандидатов на точное расстояние
+
+    static size_t lengthGap(size_t a, size_t b) { return a > b ? a - b : b - a; }
+
+    // уникальные триграммы строки с краевыми маркерами ("\1\1a", "\1ab", ..., "yz\1")
+    static void trigrams(const std::string& s, std::vector<uint32_t>& out) {
+        out.clear();
+        uint32_t g = 0x0101;
+        for (unsigned char c : s) { g = ((g << 8) | c) & 0xFFFFFF; out.push_back(g); }
+        if (!s.empty()) out.push_back(((g << 8) | 1) & 0xFFFFFF);
+        std::sort(out.begin(), out.end());
+        out.erase(std::unique(out.begin(), out.end()), out.end());
+    }
+
+    // Левенштейн в одну строку таблицы; row — переиспользуемый буфер
+    static unsigned editDistance(const std::string& a, const std::string& b, std::vector<unsigned>& row) {
+        row.resize(b.size() + 1);
+        for (size_t j = 0; j <= b.size(); ++j) row[j] = (unsigned)j;
+        for (size_t i = 1; i <= a.size(); ++i) {
+            unsigned diag = row[0];
+            row[0] = (unsigned)i;
+            const char ca = a[i - 1];
+            for (size_t j = 1; j <= b.size(); ++j) {
+                const unsigned up = row[j];
+                unsigned v = diag + (ca != b[j - 1]);
+                if (up + 1 < v)         v = up + 1;
+                if (row[j - 1] + 1 < v) v = row[j - 1] + 1;
+                row[j] = v;
+                diag = up;
+            }
+        }
+        return row[b.size()];
+    }
+
+    std::vector<std::string> keys_;   // lower(nonstd), по алфавиту
+    std::vector<CompInfo>    infos_;
+    std::unordered_map<uint32_t, std::vector<uint32_t>> postings_;
+};
+
+static constexpr size_t kSuggestions = 5;
+
+#ifndef ALTIUM_CONVERTER_NO_MAIN // только для меню и пакетного режима
+
+// индекс для текущей базы; пересобирается под мьютексом, если база изменилась (новые
+// компоненты, перезагрузка). Возвращается общий указатель: индекс, который ещё читает
+// другой поток, не пересобирается у него под руками — новая версия строится отдельно.
+static std::shared_ptr<const SimilarityIndex> similarityIndex(const ComponentDb& dbMap) {
+    static std::mutex m;
+    static std::shared_ptr<const SimilarityIndex> index;
+    static uint64_t builtFor = 0;
+    std::lock_guard<std::mutex> lk(m);
+    if (!index || builtFor != dbMap.revision()) {
+        auto next = std::make_shared<SimilarityIndex>();
+        next->build(dbMap);
+        index = std::move(next);
+        builtFor = dbMap.revision();
+    }
+    return index;
+}
+
+static std::string describeSuggestion(const SimilarityIndex::Match& m) {
+    return m.info.to_delete ? "[удалять] (" + m.key + ")" : m.info.standard;
+}
+
+// быстрое да/нет
+static bool askYesNo(const std::string& question, bool defNo = true) {
+    while (true) {
+        std::cout << question << (defNo ? " [y/N]: " : " [Y/n]: ");
+        std::string s; std::getline(std::cin, s);
+        if (s.empty()) return !defNo;
+        char c = (char)std::tolower((unsigned char)s[0]);
+        if (c=='y') return true;
+        if (c=='n') return false;
+    }
+}
+
+
+// запись строки в CSV с ';' и кавычками по необходимости
+static void writeCsvSemicolonRow(std::ofstream& f, const std::vector<std::string>& cells) {
+    std::string row;
+    appendCsvRow(row, cells, Quoting::Full);
+    f.write(row.data(), (std::streamsize)row.size());
+}
+
+static std::vector<std::string> listFiles(const std::string& dir){
+    std::vector<std::string> v;
+    if(!fs::exists(dir) || !fs::is_directory(dir)) return v;
+    for (const auto& ent: fs::directory_iterator(dir)) {
+        if (fs::is_regular_file(ent.path()) && hasExtension(ent.path(), kExts))
+            v.push_back(ent.path().string());
+    }
+    std::sort(v.begin(), v.end());
+    return v;
+}
+
+static void renderMenu(const std::vector<std::string>& items, int selected, const std::string& title) {
+    std::cout << "\x1b[H"; // Home
+    std::cout << title << "\n\n";
+    for (int i = 0; i < (int)items.size(); ++i) {
+        std::cout << "\x1b[K";
+        if (i == selected) std::cout << "\x1b[7m" << (i+1) << ". " << items[i] << "\x1b[0m\n";
+        else               std::cout << (i+1) << ". " << items[i] << "\n";
+    }
+    std::cout << "\n\x1b[KUse Up/Down, Enter. (F5 = refresh)\n";
+    std::cout.flush();
+}
+
+static int selectIndex(const std::vector<std::string>& items, const std::string& title) {
+    std::cout << "\x1b[2J\x1b[H"; // clear once
+    int sel = 0;
+    renderMenu(items, sel, title);
+    while (true) {
+        switch (readKey()) {
+            case Key::Enter:   return sel;
+            case Key::Up:      sel = (sel - 1 + (int)items.size()) % (int)items.size(); renderMenu(items, sel, title); break;
+            case Key::Down:    sel = (sel + 1) % (int)items.size(); renderMenu(items, sel, title); break;
+            case Key::Refresh: return -2; // F5 → обновить список
+            default:           break;
+        }
+    }
+}
+
+// показать меню выбора файла базы (из Components)
+static std::string pickComponentsFile(const std::string& forComponent) {
+    auto files = listComponentDbFiles();
+    if (files.empty()) return "";
+    std::vector<std::string> items;
+    for (auto& f : files) items.push_back(fs::path(f).filename().string());
+    int idx = selectIndex(items, "=== Выберите CSV для: \"" + forComponent + "\" ===");
+    if (idx < 0 || idx >= (int)files.size()) return "";
+    return files[idx];
+}
+
+// записать "nonstd;std;del" для файла базы в журнал (на диск — в finishDbSession)
+static void journalComponent(const std::string& dbPath, const std::string& nonStandardName, const CompInfo& info) {
+    gDbJournal.add(JournalEntry{ nonStandardName, info, fs::path(dbPath).filename().string() });
+    std::cout << "Добавлено в: " << fs::path(dbPath).filename().string() << "\n";
+}
+
+// то же и опубликовать новую версию базы в памяти
+static std::optional<CompInfo>
+appendComponentToDb(const std::string& dbPath, const std::string& nonStandardName, const CompInfo& info,
+                    ComponentDbStore& store) {
+    journalComponent(dbPath, nonStandardName, info);
+    store.update([&](ComponentDb& db) { db.set(nonStandardName, info); });
+    return info;
+}
+
+// предложить добавить компонент в выбранную базу
+static std::optional<CompInfo>
+maybeAddComponentToDb(const std::string& nonStandardName,
+                      ComponentDbStore& store /* онлайн-обновление */) {
+    std::cout << "Компонент не найден в базе: \"" << nonStandardName << "\"\n";
+    const auto similar = similarityIndex(*store.current())->nearest(nonStandardName, kSuggestions);
+    if (!similar.empty()) {
+        std::cout << "Похожие в базе:\n";
+        for (size_t i = 0; i < similar.size(); ++i)
+            std::cout << "  " << (i + 1) << ") " << describeSuggestion(similar[i])
+                      << "   ← " << similar[i].key << " (отличий: " << similar[i].distance << ")\n";
+    }
+    if (!askYesNo("Добавить этот компонент в базу?", true))
+        return std::nullopt;
+
+    // выбрать CSV в Components
+    std::string dbPath = pickComponentsFile(nonStandardName);
+    if (dbPath.empty()) {
+        std::cout << "Файл базы не выбран. Пропуск.\n";
+        return std::nullopt;
+    }
+
+    // ввести стандартное имя (по умолчанию = nonStandardName, номер = вариант из похожих)
+    std::cout << "Введите стандартное имя (Enter = оставить как есть"
+              << (similar.empty() ? "" : ", 1.." + std::to_string(similar.size()) + " = похожий из списка") << "):\n";
+    std::cout << "  non-std: " << nonStandardName << "\n";
+    std::cout << "  std    : ";
+    std::string stdName;
+    std::getline(std::cin, stdName);
+    const unsigned long pick = stdName.find_first_not_of("0123456789") == std::string::npos && !stdName.empty()
+                             ? std::strtoul(stdName.c_str(), nullptr, 10) : 0;
+    if (pick >= 1 && pick <= similar.size()) {
+        const CompInfo& chosen = similar[pick - 1].info;
+        if (chosen.to_delete) return appendComponentToDb(dbPath, nonStandardName, CompInfo{ nonStandardName, true }, store);
+        stdName = chosen.standard;
+        std::cout << "  std    = " << stdName << "\n";
+    }
+    if (stdName.empty()) stdName = nonStandardName;
+
+    // спросить флаг удаления
+    bool del = askYesNo("Удалять этот элемент в будущем? (1 = да, 0 = нет)", false);
+
+    return appendComponentToDb(dbPath, nonStandardName, CompInfo{ stdName, del }, store);
+}
+#endif
+
+
+// -------- Правила нормализации (Settings/Normalize.rules) --------
+// Правила домена (конденсаторы, резисторы, …), выбор нормализуемых столбцов и правило
+// поворота читаются из файла при запуске и компилируются. Шаблон правила — упрощённое
+// регулярное выражение, всегда на всю строку и без учёта регистра (ASCII):
+//   символ, .  \s \d \w \t  [...] [^...]  с квантификаторами * + ?
+//   (...) (?:...) с вариантами через |, группа может быть необязательной: (...)?
+//   @имя — код из таблицы корпусов "@имя = коды" (самое длинное совпадение)
+// Квантификаторы у символов/классов жадные и без отката; перебор есть только у групп
+// (варианты | и (...)?). Для правил домена это даёт тот же результат, что std::regex,
+// но время сопоставления линейно и не зависит от «неудачных» строк.
+// Замена: $1..$9 — группы, {...} — выводится, только если все группы внутри непустые.
+static const char* kRulesFile = "Settings/Normalize.rules";
+
+static const char* kDefaultRules =
+R"(# Правила нормализации Altium Converter
+# Пустые строки и строки, начинающиеся с '#', игнорируются.
+
+# Нормализуется (дважды) и сверяется с базой каждый N-й столбец: (i+1) % N == 0
+normalize_every = 5
+# Столбец с именем компонента для сверки с базой (с 1)
+component_column = 5
+
+# Поворот: если обозначение начинается с одного из префиксов — заменить угол
+rotate_designator_column = 1
+rotate_column = 4
+rotate_prefixes = CR
+rotate_map = 180:0 270:90
+
+# Таблицы корпусов
+@chip = 0402 0603 0805 1206 1210
+
+# группа: шаблон => замена
+# Группы применяются по порядку первого упоминания, внутри группы — первое подошедшее правило.
+
+# 0402|0603|0805|1206|1210 - X5R|X7R - <VOLTAGE...> → корпус-<VOLTAGE...>
+capacitor: \s*(@chip)\s*-\s*(X5R|X7R)\s*-\s*(\d+V-.*) => $1-$3
+# 0402|... - NP0 - <VOLTAGE...> → корпус-N<VOLTAGE...>
+capacitor: \s*(@chip)\s*-\s*NP0\s*-\s*(\d+V-.*) => $1-N$2
+
+# <Pkg>-<Power W>-<Value>-<ppm>[-<tol%>] → убрать -ppm-, tol оставить
+resistor: \s*([^- \t]+)\s*-\s*(\d+(?:\.\d+)?|\d+/\d+)\s*W\s*-\s*(0R|\d+(?:\.\d+)?[RKM])\s*-\s*\d+\s*ppm(?:\s*-\s*(\d+%))?\s* => $1-$2W-$3{-$4}
+)";
+
+// таблица кодов корпусов: первый байт (в нижнем регистре) → коды, длинные первыми
+struct CodeTable {
+    std::vector<std::string> byFirst[256];
+
+    void add(const std::string& code) {
+        if (code.empty()) return;
+        auto& v = byFirst[(unsigned char)std::tolower((unsigned char)code[0])];
+        v.push_back(tolower_copy(code));
+        std::stable_sort(v.begin(), v.end(), [](const std::string& a, const std::string& b) { return a.size() > b.size(); });
+    }
+
+    size_t longestMatch(const std::string& s, size_t pos) const {
+        if (pos >= s.size()) return 0;
+        for (const auto& code : byFirst[(unsigned char)std::tolower((unsigned char)s[pos])]) {
+            if (s.size() - pos < code.size()) continue;
+            size_t k = 1;
+            while (k < code.size() && std::tolower((unsigned char)s[pos + k]) == (unsigned char)code[k]) ++k;
+            if (k == code.size()) return k;
+        }
+        return 0;
+    }
+};
+
+class RulePattern {
+public:
+    using Captures = std::array<std::pair<int, int>, 10>; // [0] — вся строка
+
+    bool compile(const std::string& src, const std::unordered_map<std::string, std::shared_ptr<CodeTable>>& tables,
+                 std::string& err) {
+        src_ = src; pos_ = 0; groups_ = 0; tables_ = &tables; err_.clear();
+        if (pos_ < src_.size() && src_[pos_] == '^') ++pos_;
+        root_ = parseAlternatives();
+        if (err_.empty() && pos_ < src_.size()) err_ = "лишняя ')' в позиции " + std::to_string(pos_ + 1);
+        tables_ = nullptr;
+        if (!err_.empty()) { err = err_; return false; }
+        findRequiredLiteral();
+        return true;
+    }
+
+    int groupCount() const { return groups_; }
+
+    bool match(const std::string& s, Captures& caps) const {
+        if (!required_.empty() && !containsNoCase(s, required_)) return false;
+        for (auto& c : caps) c = { -1, -1 };
+        for (const Seq& alt : root_) {
+            Captures saved = caps;
+            if (run(s, alt, 0, 0, nullptr, caps)) { caps[0] = { 0, (int)s.size() }; return true; }
+            caps = saved;
+        }
+        return false;
+    }
+
+private:
+    struct Item;
+    using Seq = std::vector<Item>;
+    struct Item {
+        enum class Kind { Class, Table, Group } kind = Kind::Class;
+        uint64_t bits[4] = {0, 0, 0, 0};     // Class: множество байтов
+        uint32_t minRep = 1, maxRep = 1;
+        std::shared_ptr<CodeTable> table;    // Table
+        int  capture  = -1;                  // Group: номер группы, -1 = (?:...)
+        bool optional = false;               // Group: (...)?
+        std::vector<Seq> alts;               // Group
+    };
+    struct Frame { const Seq* seq; size_t idx; int capture; const Frame* next; };
+
+    static bool test(const uint64_t* bits, unsigned char c) { return (bits[c >> 6] >> (c & 63)) & 1; }
+    static void set(uint64_t* bits, unsigned char c)        { bits[c >> 6] |= uint64_t(1) << (c & 63); }
+    static void setNoCase(uint64_t* bits, unsigned char c) {
+        set(bits, c);
+        set(bits, (unsigned char)std::tolower(c));
+        set(bits, (unsigned char)std::toupper(c));
+    }
+
+    static bool containsNoCase(const std::string& s, const std::string& lowNeedle) {
+        if (lowNeedle.size() > s.size()) return false;
+        for (size_t i = 0; i + lowNeedle.size() <= s.size(); ++i) {
+            size_t k = 0;
+            while (k < lowNeedle.size() && std::tolower((unsigned char)s[i + k]) == (unsigned char)lowNeedle[k]) ++k;
+            if (k == lowNeedle.size()) return true;
+        }
+        return false;
+    }
+
+    bool run(const std::string& s, const Seq& seq, size_t i, size_t pos, const Frame* next, Captures& caps) const {
+        for (; i < seq.size(); ++i) {
+            const Item& it = seq[i];
+            if (it.kind == Item::Kind::Class) {
+                uint32_t n = 0;
+                while (n < it.maxRep && pos < s.size() && test(it.bits, (unsigned char)s[pos])) { ++pos; ++n; }
+                if (n < it.minRep) return false;
+            } else if (it.kind == Item::Kind::Table) {
+                size_t len = it.table->longestMatch(s, pos);
+                if (len == 0) return false;
+                pos += len;
+            } else {
+                Frame f{ &seq, i + 1, it.capture, next };
+                for (const Seq& alt : it.alts) {
+                    Captures saved = caps;
+                    if (it.capture >= 0) caps[it.capture].first = (int)pos;
+                    if (run(s, alt, 0, pos, &f, caps)) return true;
+                    caps = saved;
+                }
+                if (!it.optional) return false;
+                // (...)? — вариант без группы: продолжаем с той же позиции
+            }
+        }
+        if (next) {
+            if (next->capture >= 0) caps[next->capture].second = (int)pos;
+            return run(s, *next->seq, next->idx, pos, next->next, caps);
+        }
+        return pos == s.size();
+    }
+
+    // самая длинная обязательная буквенно-цифровая подстрока верхнего уровня — быстрый отсев
+    void findRequiredLiteral() {
+        required_.clear();
+        if (root_.size() != 1) return;
+        std::string cur;
+        auto flush = [&] { if (cur.size() > required_.size()) required_ = cur; cur.clear(); };
+        for (const Item& it : root_[0]) {
+            int ch = -1, count = 0;
+            if (it.kind == Item::Kind::Class && it.minRep == 1 && it.maxRep == 1)
+                for (int c = 0; c < 256; ++c)
+                    if (test(it.bits, (unsigned char)c)) { ++count; if (ch < 0 || std::islower(c)) ch = c; }
+            const bool literal = ch >= 0 && std::isalnum(ch) &&
+                                 count == (std::isalpha(ch) ? 2 : 1);
+            if (literal) cur.push_back((char)ch);
+            else         flush();
+        }
+        flush();
+        if (required_.size() < 2) required_.clear();
+    }
+
+    // --- разбор ---
+    bool more() const { return pos_ < src_.size() && err_.empty(); }
+    void fail(const std::string& m) { if (err_.empty()) err_ = m + " в позиции " + std::to_string(pos_ + 1); }
+
+    std::vector<Seq> parseAlternatives() {
+        std::vector<Seq> alts(1);
+        while (more() && src_[pos_] != ')') {
+            if (src_[pos_] == '|') { ++pos_; alts.emplace_back(); continue; }
+            if (src_[pos_] == '$' && pos_ + 1 == src_.size()) { ++pos_; continue; } // $ в конце — и так вся строка
+            parseItem(alts.back());
+        }
+        return alts;
+    }
+
+    void parseItem(Seq& seq) {
+        Item it;
+        const char c = src_[pos_++];
+        if (c == '(') {
+            it.kind = Item::Kind::Group;
+            if (src_.compare(pos_, 2, "?:") == 0) pos_ += 2;
+            else if (groups_ >= 9) { fail("больше 9 групп"); return; }
+            else it.capture = ++groups_;
+            it.alts = parseAlternatives();
+            if (!err_.empty()) return;
+            if (pos_ >= src_.size() || src_[pos_] != ')') { fail("нет закрывающей ')'"); return; }
+            ++pos_;
+            if (pos_ < src_.size() && src_[pos_] == '?') { it.optional = true; ++pos_; }
+            else if (pos_ < src_.size() && (src_[pos_] == '*' || src_[pos_] == '+')) { fail("у группы допустим только '?'"); return; }
+            seq.push_back(std::move(it));
+            return;
+        }
+        if (c == '@') {
+            size_t b = pos_;
+            while (pos_ < src_.size() && (std::isalnum((unsigned char)src_[pos_]) || src_[pos_] == '_')) ++pos_;
+            auto t = tables_->find(src_.substr(b, pos_ - b));
+            if (t == tables_->end()) { fail("неизвестная таблица @" + src_.substr(b, pos_ - b)); return; }
+            it.kind = Item::Kind::Table;
+            it.table = t->second;
+            seq.push_back(std::move(it));
+            return;
+        }
+        if (c == '[')       parseClass(it);
+        else if (c == '.')  { for (int b = 0; b < 256; ++b) if (b != '\n' && b != '\r') set(it.bits, (unsigned char)b); }
+        else if (c == '\\') parseEscape(it.bits);
+        else if (c == ')' || c == '*' || c == '+' || c == '?') { --pos_; fail(std::string("неожиданный '") + c + "'"); return; }
+        else                setNoCase(it.bits, (unsigned char)c);
+        if (!err_.empty()) return;
+
+        if (pos_ < src_.size()) {
+            switch (src_[pos_]) {
+                case '*': it.minRep = 0; it.maxRep = UINT32_MAX; ++pos_; break;
+                case '+': it.minRep = 1; it.maxRep = UINT32_MAX; ++pos_; break;
+                case '?': it.minRep = 0; it.maxRep = 1;          ++pos_; break;
+            }
+        }
+        seq.push_back(std::move(it));
+    }
+
+    // \s \d \w \t \n \r или экранированный символ
+    void parseEscape(uint64_t* bits) {
+        if (pos_ >= src_.size()) { fail("'\\' в конце шаблона"); return; }
+        const char e = src_[pos_++];
+        switch (e) {
+            case 's': for (char w : std::string(" \t\n\v\f\r")) set(bits, (unsigned char)w); break;
+            case 'd': for (char d = '0'; d <= '9'; ++d) set(bits, (unsigned char)d); break;
+            case 'w': for (int b = 0; b < 128; ++b) if (std::isalnum(b) || b == '_') set(bits, (unsigned char)b); break;
+            case 't': set(bits, '\t'); break;
+            case 'n': set(bits, '\n'); break;
+            case 'r': set(bits, '\r'); break;
+            default:  setNoCase(bits, (unsigned char)e); break;
+        }
+    }
+
+    void parseClass(Item& it) {
+        bool negate = false;
+        if (pos_ < src_.size() && src_[pos_] == '^') { negate = true; ++pos_; }
+        bool first = true;
+        while (true) {
+            if (pos_ >= src_.size()) { fail("нет закрывающей ']'"); return; }
+            char c = src_[pos_];
+            if (c == ']' && !first) { ++pos_; break; }
+            first = false;
+            ++pos_;
+            if (c == '\\') { parseEscape(it.bits); if (!err_.empty()) return; continue; }
+            if (pos_ + 1 < src_.size() && src_[pos_] == '-' && src_[pos_ + 1] != ']') {
+                const char hi = src_[pos_ + 1];
+                pos_ += 2;
+                for (int b = (unsigned char)c; b <= (unsigned char)hi; ++b) setNoCase(it.bits, (unsigned char)b);
+                continue;
+            }
+            setNoCase(it.bits, (unsigned char)c);
+        }
+        if (negate) for (auto& w : it.bits) w = ~w;
+    }
+
+    std::string src_;
+    size_t pos_ = 0;
+    int groups_ = 0;
+    std::string err_;
+    const std::unordered_map<std::string, std::shared_ptr<CodeTable>>* tables_ = nullptr;
+
+    std::vector<Seq> root_;
+    std::string required_; // в нижнем регистре
+};
+
+// строка замены: текст, $n, {...}
+class RuleTemplate {
+public:
+    bool compile(const std::string& src, int groupCount, std::string& err) {
+        pieces_.clear();
+        bool inOpt = false;
+        for (size_t i = 0; i < src.size(); ++i) {
+            const char c = src[i];
+            if (c == '$' && i + 1 < src.size() && std::isdigit((unsigned char)src[i + 1])) {
+                const int n = src[++i] - '0';
+                if (n > groupCount) { err = "нет группы $" + std::to_string(n); return false; }
+                pieces_.push_back({ Piece::Kind::Group, {}, n });
+            } else if (c == '{' || c == '}') {
+                if ((c == '{') == inOpt) { err = std::string("непарная '") + c + "'"; return false; }
+                inOpt = (c == '{');
+                pieces_.push_back({ inOpt ? Piece::Kind::OptBegin : Piece::Kind::OptEnd, {}, 0 });
+            } else {
+                if (c == '\\' && i + 1 < src.size()) ++i;
+                if (pieces_.empty() || pieces_.back().kind != Piece::Kind::Text)
+                    pieces_.push_back({ Piece::Kind::Text, {}, 0 });
+                pieces_.back().text.push_back(src[i]);
+            }
+        }
+        if (inOpt) { err = "нет закрывающей '}'"; return false; }
+        return true;
+    }
+
+    std::string expand(const std::string& s, const RulePattern::Captures& caps) const {
+        auto group = [&](int n) -> std::pair<int, int> { return caps[n].second >= 0 ? caps[n] : std::pair<int, int>{0, 0}; };
+        std::string out;
+        out.reserve(s.size());
+        for (size_t i = 0; i < pieces_.size(); ++i) {
+            const Piece& p = pieces_[i];
+            switch (p.kind) {
+                case Piece::Kind::Text:  out += p.text; break;
+                case Piece::Kind::Group: { auto g = group(p.group); out.append(s, g.first, g.second - g.first); break; }
+                case Piece::Kind::OptEnd: break;
+                case Piece::Kind::OptBegin: {
+                    bool all = true;
+                    for (size_t j = i + 1; pieces_[j].kind != Piece::Kind::OptEnd; ++j)
+                        if (pieces_[j].kind == Piece::Kind::Group) { auto g = group(pieces_[j].group); all = all && g.second > g.first; }
+                    if (!all) while (pieces_[i].kind != Piece::Kind::OptEnd) ++i;
+                    break;
+                }
+            }
+        }
+        return out;
+    }
+
+private:
+    struct Piece { enum class Kind { Text, Group, OptBegin, OptEnd } kind; std::string text; int group; };
+    std::vector<Piece> pieces_;
+};
+
+struct NormalizeRule {
+    RulePattern  pattern;
+    RuleTemplate replacement;
+};
+
+struct RuleGroup {
+    std::string name;
+    std::vector<NormalizeRule> rules;
+};
+
+struct ConversionRules {
+    size_t normalizeEvery    = 5;   // (i+1) % N == 0
+    size_t componentColumn   = 4;   // с 0
+    size_t designatorColumn  = 0;
+    size_t rotationColumn    = 3;
+    size_t xColumn           = 1;   // координаты — только для --columnar
+    size_t yColumn           = 2;
+    std::string rotatePrefixes = "CR";
+    std::vector<std::pair<std::string, std::string>> rotateMap = { {"180", "0"}, {"270", "90"} };
+    std::vector<RuleGroup> groups;
+    uint64_t fingerprint = 0;       // отпечаток текста правил (манифест конвертации)
+    std::unordered_set<std::string> packages; // все коды таблиц @имя, lower() — корпус в сводке
+
+    bool isPointColumn(size_t i) const { return normalizeEvery && ((i + 1) % normalizeEvery) == 0; }
+
+    // группы по порядку, внутри группы — первое подошедшее правило
+    std::string apply(std::string s) const {
+        RulePattern::Captures caps;
+        for (const auto& g : groups) {
+            for (const auto& r : g.rules) {
+                if (r.pattern.match(s, caps)) { s = r.replacement.expand(s, caps); break; }
+            }
+        }
+        return s;
+    }
+};
+
+static ConversionRules gRules;
+
+// разобрать текст правил; ошибки — "файл:строка: сообщение"
+static bool compileRules(const std::string& text, const std::string& origin, ConversionRules& out) {
+    ConversionRules r;
+    std::unordered_map<std::string, std::shared_ptr<CodeTable>> tables;
+    std::istringstream in(text);
+    std::string line, err;
+    size_t lineNo = 0;
+    auto error = [&](const std::string& m) { std::cerr << origin << ":" << lineNo << ": " << m << "\n"; return false; };
+    auto number = [](const std::string& v, unsigned long& n) { // только цифры, без мусора в конце
+        char* end = nullptr;
+        n = std::strtoul(v.c_str(), &end, 10);
+        return !v.empty() && std::isdigit((unsigned char)v[0]) && *end == '\0';
+    };
+    auto column = [&](const std::string& v, size_t& dst) {
+        unsigned long n = 0;
+        if (!number(v, n) || n == 0) return false;
+        dst = n - 1;
+        return true;
+    };
+
+    while (std::getline(in, line)) {
+        ++lineNo;
+        rstrip_cr(line);
+        const std::string t = trim(line);
+        if (t.empty() || t[0] == '#') continue;
+
+        if (t[0] == '@') {                                   // @имя = коды
+            size_t eq = t.find('=');
+            if (eq == std::string::npos) return error("ожидается '@имя = коды'");
+            auto table = std::make_shared<CodeTable>();
+            std::istringstream codes(t.substr(eq + 1));
+            for (std::string code; codes >> code; ) { table->add(code); r.packages.insert(tolower_copy(code)); }
+            tables[trim(t.substr(1, eq - 1))] = table;
+            continue;
+        }
+
+        size_t name = 0;
+        while (name < t.size() && (std::isalnum((unsigned char)t[name]) || t[name] == '_')) ++name;
+        if (name > 0 && name < t.size() && t[name] == ':') {  // группа: шаблон => замена
+            const size_t arrow = t.find("=>", name);
+            if (arrow == std::string::npos) return error("ожидается 'группа: шаблон => замена'");
+            NormalizeRule rule;
+            if (!rule.pattern.compile(trim(t.substr(name + 1, arrow - name - 1)), tables, err)) return error(err);
+            if (!rule.replacement.compile(trim(t.substr(arrow + 2)), rule.pattern.groupCount(), err)) return error(err);
+            const std::string group = t.substr(0, name);
+            auto g = std::find_if(r.groups.begin(), r.groups.end(), [&](const RuleGroup& x) { return x.name == group; });
+            if (g == r.groups.end()) { r.groups.push_back({ group, {} }); g = r.groups.end() - 1; }
+            g->rules.push_back(std::move(rule));
+            continue;
+        }
+
+        const size_t eq = t.find('=');                       // ключ = значение
+        if (eq == std::string::npos) return error("непонятная строка");
+        const std::string key = trim(t.substr(0, eq)), value = trim(t.substr(eq + 1));
+        if (key == "normalize_every") {
+            unsigned long n = 0;
+            if (!number(value, n)) return error("normalize_every: ожидается целое число (0 — не нормализовать)");
+            r.normalizeEvery = n;
+        } else if (key == "component_column") {
+            if (!column(value, r.componentColumn)) return error("номер столбца — целое число от 1");
+        } else if (key == "rotate_designator_column") {
+            if (!column(value, r.designatorColumn)) return error("номер столбца — целое число от 1");
+        } else if (key == "rotate_column") {
+            if (!column(value, r.rotationColumn)) return error("номер столбца — целое число от 1");
+        } else if (key == "x_column") {
+            if (!column(value, r.xColumn)) return error("номер столбца — целое число от 1");
+        } else if (key == "y_column") {
+            if (!column(value, r.yColumn)) return error("номер столбца — целое число от 1");
+        } else if (key == "rotate_prefixes") {
+            r.rotatePrefixes.clear();
+            for (char c : value) if (!std::isspace((unsigned char)c)) r.rotatePrefixes.push_back((char)std::toupper((unsigned char)c));
+        } else if (key == "rotate_map") {
+            r.rotateMap.clear();
+            std::istringstream pairs(value);
+            for (std::string p; pairs >> p; ) {
+                size_t colon = p.find(':');
+                if (colon == std::string::npos) return error("ожидается 'было:стало'");
+                r.rotateMap.emplace_back(p.substr(0, colon), p.substr(colon + 1));
+            }
+        } else {
+            return error("неизвестный параметр '" + key + "'");
+        }
+    }
+    r.fingerprint = fnv1a(text);
+    out = std::move(r);
+    return true;
+}
+
+// прочитать и разобрать файл правил; нет файла — встроенные правила (ничего не создаётся).
+// missing (необязательно) — true, если файла не было
+static bool readRules(const std::string& path, ConversionRules& out, bool* missing = nullptr) {
+    std::string text;
+    std::ifstream in(path, std::ios::binary);
+    if (in) {
+        text.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        if (text.compare(0, 3, "\xEF\xBB\xBF") == 0) text.erase(0, 3);
+    } else {
+        text = kDefaultRules;
+    }
+    if (missing) *missing = !in;
+    return compileRules(text, path, out);
+}
+
+#ifndef ALTIUM_CONVERTER_NO_MAIN // только для меню и пакетного режима
+// загрузить Settings/Normalize.rules в gRules (при отсутствии — создать из встроенных правил)
+static bool loadRules() {
+    bool missing = false;
+    if (!readRules(kRulesFile, gRules, &missing)) return false;
+    if (missing) {
+        std::error_code ec;
+        fs::create_directories(fs::path(kRulesFile).parent_path(), ec);
+        std::ofstream(kRulesFile, std::ios::binary) << kDefaultRules;
+    }
+    return true;
+}
+#endif
+
+// -------- Транслитерация похожих символов (UTF-8 → ASCII) --------
+// Таблица двухуровневая: страница (cp >> 8) → 256 замен. Заполнены только страницы,
+// где есть что заменять, поэтому поиск — два обращения к памяти на символ.
+struct GlyphReplacement { char bytes[4]; uint8_t len; bool mapped; };
+using GlyphPage = std::array<GlyphReplacement, 256>;
+
+static const std::array<std::unique_ptr<GlyphPage>, 256>& glyphTable() {
+    static const auto table = [] {
+        std::array<std::unique_ptr<GlyphPage>, 256> t;
+        auto put = [&](uint32_t cp, const char* to) {
+            auto& page = t[cp >> 8];
+            if (!page) page = std::make_unique<GlyphPage>();
+            GlyphReplacement& r = (*page)[cp & 0xFF];
+            r.len = (uint8_t)std::strlen(to);
+            std::memcpy(r.bytes, to, r.len);
+            r.mapped = true;
+        };
+        // Кириллица — визуально похожие буквы
+        static const std::pair<uint32_t, const char*> cyrillic[] = {
+            // Верхний регистр
+            {0x0410, "A"}, {0x0412, "B"}, {0x0415, "E"}, {0x041A, "K"},
+            {0x041C, "M"}, {0x041D, "H"}, {0x041E, "O"}, {0x0420, "P"},
+            {0x0421, "C"}, {0x0422, "T"}, {0x0423, "Y"}, {0x0425, "X"},
+            {0x0405, "S"}, {0x0406, "I"}, {0x0408, "J"},
+            // Нижний регистр
+            {0x0430, "a"}, {0x0432, "b"}, {0x0435, "e"}, {0x043A, "k"},
+            {0x043C, "m"}, {0x043D, "n"}, {0x043E, "o"}, {0x0440, "p"},
+            {0x0441, "c"}, {0x0442, "t"}, {0x0443, "y"}, {0x0445, "x"},
+            {0x0455, "s"}, {0x0456, "i"}, {0x0458, "j"},
+        };
+        // Греческие буквы, похожие на латинские
+        static const std::pair<uint32_t, const char*> greek[] = {
+            {0x0391, "A"}, {0x0392, "B"}, {0x0395, "E"}, {0x0396, "Z"}, {0x0397, "H"},
+            {0x0399, "I"}, {0x039A, "K"}, {0x039C, "M"}, {0x039D, "N"}, {0x039F, "O"},
+            {0x03A1, "P"}, {0x03A4, "T"}, {0x03A5, "Y"}, {0x03A7, "X"},
+            {0x03B1, "a"}, {0x03B9, "i"}, {0x03BA, "k"}, {0x03BD, "v"}, {0x03BF, "o"},
+            {0x03C1, "p"}, {0x03C5, "u"}, {0x03C7, "x"},
+        };
+        // Единицы, тире и пробелы из значений компонентов
+        static const std::pair<uint32_t, const char*> units[] = {
+            {0x00B5, "u"},   {0x03BC, "u"},     // µ (micro sign), μ
+            {0x2126, "Ohm"}, {0x03A9, "Ohm"},   // Ω (ohm sign), Ω
+            {0x00A0, " "},   {0x3000, " "},     // неразрывный, идеографический пробел
+            {0x2010, "-"}, {0x2011, "-"}, {0x2012, "-"}, {0x2013, "-"}, {0x2014, "-"}, {0x2015, "-"},
+            {0x2212, "-"},                      // минус
+        };
+        for (const auto& [cp, to] : cyrillic) put(cp, to);
+        for (const auto& [cp, to] : greek)    put(cp, to);
+        for (const auto& [cp, to] : units)    put(cp, to);
+        // Полноширинная латиница, цифры и знаки: U+FF01..U+FF5E → '!'..'~'
+        for (uint32_t cp = 0xFF01; cp <= 0xFF5E; ++cp) {
+            const char ascii[2] = { (char)(cp - 0xFF01 + '!'), 0 };
+            put(cp, ascii);
+        }
+        return t;
+    }();
+    return table;
+}
+
+// Заменяет визуально похожие кириллические (а также греческие, полноширинные) буквы и
+// знаки единиц на ASCII за один проход. Строка из одного ASCII возвращается без копирования.
+static std::string fixCyrillicLetters(std::string s) {
+    if (isAscii(s.data(), s.size())) return s;
+
+    const auto& table = glyphTable();
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(s.data());
+    const size_t n = s.size();
+    std::string out;
+    size_t copied = 0; // s[copied, i) ещё не перенесено в out
+    size_t i = 0;
+    while (i < n) {
+        const unsigned char c = p[i];
+        if (c < 0x80) { ++i; continue; }
+
+        uint32_t cp = 0; size_t len = 0;
+        if      ((c & 0xE0) == 0xC0) { cp = c & 0x1F; len = 2; }
+        else if ((c & 0xF0) == 0xE0) { cp = c & 0x0F; len = 3; }
+        else if ((c & 0xF8) == 0xF0) { cp = c & 0x07; len = 4; }
+        bool valid = len > 0 && i + len <= n;
+        for (size_t k = 1; valid && k < len; ++k) {
+            if ((p[i + k] & 0xC0) != 0x80) valid = false;
+            else cp = (cp << 6) | (p[i + k] & 0x3F);
+        }
+        static const uint32_t kMinCp[5] = { 0, 0, 0x80, 0x800, 0x10000 };
+        if (valid && (cp < kMinCp[len] || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF))) valid = false;
+        if (!valid) { ++i; continue; }          // битый/избыточный UTF-8 — переносим как есть
+
+        const GlyphReplacement* r = nullptr;
+        if (cp < 0x10000 && table[cp >> 8]) {
+            const GlyphReplacement& g = (*table[cp >> 8])[cp & 0xFF];
+            if (g.mapped) r = &g;
+        }
+        if (r) {
+            if (out.empty()) out.reserve(n);
+            out.append(s, copied, i - copied);
+            out.append(r->bytes, r->len);
+            copied = i + len;
+        }
+        i += len;
+    }
+    if (copied == 0) return s;                  // заменять было нечего
+    out.append(s, copied, std::string::npos);
+    return out;
+}
+
+// Глобальная нормализация ячейки (ваши правила; rules — спец-правила домена)
+// пробелы и тире из таблицы транслитерации (U+00A0, U+3000, U+2010..U+2015, U+2212) → ' ' и '-'
+// ещё до текстовых шагов normalizeCell: "0603 – X7R – 50V" должен потерять пробелы перед
+// тире, а "100nF\u00A0(Murata)" — пробел в конце, как и при ASCII-написании
+static void foldSpacesAndDashes(std::string& s) {
+    if (isAscii(s.data(), s.size())) return;
+    const size_t n = s.size();
+    size_t o = 0;
+    for (size_t i = 0; i < n;) {
+        const unsigned char c  = (unsigned char)s[i];
+        const unsigned char c1 = i + 1 < n ? (unsigned char)s[i + 1] : 0;
+        const unsigned char c2 = i + 2 < n ? (unsigned char)s[i + 2] : 0;
+        if      (c == 0xC2 && c1 == 0xA0)                               { s[o++] = ' '; i += 2; } // U+00A0
+        else if (c == 0xE3 && c1 == 0x80 && c2 == 0x80)                 { s[o++] = ' '; i += 3; } // U+3000
+        else if (c == 0xE2 && c1 == 0x80 && c2 >= 0x90 && c2 <= 0x95)   { s[o++] = '-'; i += 3; } // U+2010..2015
+        else if (c == 0xE2 && c1 == 0x88 && c2 == 0x92)                 { s[o++] = '-'; i += 3; } // U+2212
+        else s[o++] = s[i++];
+    }
+    s.resize(o);
+}
+
+static std::string normalizeCell(const std::string& in, const ConversionRules& rules = gRules){
+    std::string s = in;
+    foldSpacesAndDashes(s);
+
+    // удалить (...) фрагменты: от '(' до ближайшей ')'; '(' без пары остаётся
+    if (s.find('(') != std::string::npos) {
+        std::string t; t.reserve(s.size());
+        size_t i = 0;
+        while (i < s.size()) {
+            size_t open = s.find('(', i);
+            size_t close = (open == std::string::npos) ? open : s.find(')', open + 1);
+            if (close == std::string::npos) { t.append(s, i, std::string::npos); break; }
+            t.append(s, i, open - i);
+            i = close + 1;
+        }
+        s.swap(t);
+    }
+
+    // ',' → '.'
+    for (char& c : s) if (c == ',') c = '.';
+
+    // '?' → '-'
+    for (char& c : s) if (c == '?') c = '-';
+
+    // убрать пробелы перед тире (\s+- → -)
+    {
+        auto isSpace = [](char c) { return c==' ' || c=='\t' || c=='\n' || c=='\v' || c=='\f' || c=='\r'; };
+        std::string t; t.reserve(s.size());
+        size_t i = 0;
+        while (i < s.size()) {
+            if (!isSpace(s[i])) { t.push_back(s[i++]); continue; }
+            size_t j = i;
+            while (j < s.size() && isSpace(s[j])) ++j;
+            if (j == s.size() || s[j] != '-') t.append(s, i, j - i); // пробелы не перед '-' — оставить
+            i = j;
+        }
+        s.swap(t);
+    }
+
+    // обрезать всё после '%' (сам знак оставить)
+    if (size_t p = s.find('%'); p != std::string::npos) {
+        s = s.substr(0, p+1);
+    }
+
+    // убрать всё до первой буквы/цифры/%
+    size_t pos = 0;
+    while (pos < s.size()) {
+        unsigned char ch = static_cast<unsigned char>(s[pos]);
+        if (std::isalnum(ch) || ch=='%') break;
+        ++pos;
+    }
+    if (pos > 0) s.erase(0, pos);
+
+    // если в исходнике было LESR — гарантировать его присутствие
+    if (tolower_copy(in).find("lesr") != std::string::npos) {
+        if (tolower_copy(s).find("lesr") == std::string::npos) {
+            if (!s.empty() && s.back()=='%') s += "LESR";
+            else                             s += " LESR";
+        }
+    }
+
+    s = trim(s);
+
+    // спец-правила домена (Settings/Normalize.rules)
+    s = rules.apply(std::move(s));
+    s = fixCyrillicLetters(std::move(s));
+
+    return s;
+}
+
+// -------- Кэш нормализации --------
+// Значения столбца компонента и столбцов-точек сильно повторяются (один и тот же корпус —
+// на сотнях строк), поэтому результат normalizeCell для них запоминается по исходному тексту
+// и отпечатку правил (у встроенных движков правила могут быть разными). Прочие ячейки
+// (обозначения, координаты) почти все уникальны и нормализуются напрямую. Кэш разбит на шарды
+// со своим мьютексом (общий для всех потоков); в полном шарде вытесняется одна запись по
+// алгоритму CLOCK: стрелка идёт по кругу, записи с пометкой "было обращение" получают
+// второй шанс, горячие значения так и остаются в кэше.
+class NormalizeCache {
+public:
+    explicit NormalizeCache(size_t capacity) : perShard_(std::max<size_t>(capacity / kShards, 1)) {}
+
+    // результат — в out (при попадании только копия байт в его буфер, без выделения памяти);
+    // raw и out могут быть одной строкой
+    void get(const std::string& raw, std::string& out, const ConversionRules& rules) {
+        Shard& sh = shards_[std::hash<std::string>{}(raw) % kShards];
+        {
+            std::lock_guard<std::mutex> lk(sh.m);
+            auto it = sh.map.find(raw);
+            if (it != sh.map.end() && it->second.rules == rules.fingerprint) {
+                it->second.referenced = true;
+                hits_.fetch_add(1, std::memory_order_relaxed);
+                out.assign(it->second.value);
+                return;
+            }
+        }
+        misses_.fetch_add(1, std::memory_order_relaxed);
+        std::string value = normalizeCell(raw, rules); // сама нормализация — вне блокировки
+        {
+            std::lock_guard<std::mutex> lk(sh.m);
+            insert(sh, raw, value, rules.fingerprint);
+        }
+        out = std::move(value);
+    }
+
+    uint64_t hits()   const { return hits_.load(std::memory_order_relaxed); }
+    uint64_t misses() const { return misses_.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr size_t kShards = 64;
+    struct Entry { uint64_t rules; std::string value; bool referenced; };
+    using Map = std::unordered_map<std::string, Entry>;
+    struct Shard {
+        std::mutex m;
+        Map map;
+        std::vector<const std::string*> ring; // ключи map (адреса узлов стабильны) в порядке стрелки
+        size_t hand = 0;
+    };
+
+    void insert(Shard& sh, const std::string& raw, const std::string& value, uint64_t rules) {
+        auto [it, inserted] = sh.map.try_emplace(raw);
+        it->second = Entry{ rules, value, false };
+        if (!inserted) return; // другой поток успел раньше или сменились правила — место то же
+        if (sh.ring.size() < perShard_) { sh.ring.push_back(&it->first); return; }
+        while (true) {
+            auto victim = sh.map.find(*sh.ring[sh.hand]);
+            if (!victim->second.referenced) {
+                sh.map.erase(victim);
+                sh.ring[sh.hand] = &it->first;
+                sh.hand = (sh.hand + 1) % sh.ring.size();
+                return;
+            }
+            victim->second.referenced = false;
+            sh.hand = (sh.hand + 1) % sh.ring.size();
+        }
+    }
+
+    size_t perShard_;
+    Shard  shards_[kShards];
+    std::atomic<uint64_t> hits_{0}, misses_{0};
+};
+
+static NormalizeCache gNormalizeCache(1 << 16);
+
+static void normalizeCellCached(const std::string& in, std::string& out, const ConversionRules& rules = gRules) {
+    gNormalizeCache.get(in, out, rules);
+}
+
+// ---------- Инициализация каталогов и базы корпусов ----------
+int Initialisation() {
+    enableVTMode();
+
+    // создать каталоги
+    for (const auto& folder : { "Settings", "For Conversion", "Converted", kComponentsDir.c_str(), "Documents" }) {
+        fs::path dir = fs::current_path() / folder;
+        if (!fs::exists(dir)) {
+            if (!fs::create_directory(dir)) {
+                std::cerr << "Failed to create: " << dir << "\n";
+            }
+        }
+    }
+
+    // файл со списком корпусов
+    const std::string filename = "Settings/Packages.csv";
+    if (!fs::exists(filename)) {
+        std::ofstream file(filename, std::ios::binary);
+    }
+
+    std::ifstream infile(filename);
+    if (!infile) {
+        std::cerr << "Failed to open " << filename << " for read\n";
+        return 1;
+    }
+
+    const std::string header = "Component_Name_Non_Standart;Component_Name_Standart;Delete_0_or_1\n";
+    std::string line;
+    while (std::getline(infile, line)) {
+        if (line.empty()) continue;
+        std::string fname = kComponentsDir + "/" + sanitize(line) + ".csv";
+        if (fs::exists(fname)) continue;
+        fs::create_directories(fs::path(fname).parent_path());
+        std::ofstream out(fname, std::ios::binary);
+        if (!out) { std::cerr << "Can't create " << fname << "\n"; continue; }
+        out << header;
+    }
+    return 0;
+}
+
+// -------- Очередь неизвестных компонентов (пакетный режим) --------
+// Формат файла совпадает с базой в первых трёх столбцах, чтобы строки можно было
+// дозаполнить вручную: nonstd;std;del;файл базы;кол-во;входные файлы
+struct PendingComponent {
+    std::string name;          // 5-й столбец после нормализации
+    std::string standard;      // заполняется при ревью (пусто = не решено)
+    std::string del;           // "1" = удалять
+    std::string dbFile;        // имя CSV в Components
+    size_t occurrences = 0;
+    std::vector<std::string> files;
+    std::string suggestions;   // похожие стандартные имена из базы, через '|'
+    bool seenThisRun = false;  // статистика старых записей сбрасывается при первом повторе
+};
+
+struct PendingQueue {
+    std::vector<PendingComponent> items;
+    std::unordered_map<std::string, size_t> byKey; // lower(name) → индекс в items
+
+    PendingComponent& get(const std::string& name) {
+        auto [it, inserted] = byKey.emplace(tolower_copy(name), items.size());
+        if (inserted) { items.emplace_back(); items.back().name = name; }
+        return items[it->second];
+    }
+
+    void add(const std::string& name, const std::string& file, size_t count = 1) {
+        PendingComponent& p = touch(name);
+        p.occurrences += count;
+        addFile(p, fs::path(file).filename().string());
+    }
+
+    // слить очередь одного файла (порядок слияния = порядок файлов → детерминированный результат)
+    void merge(const PendingQueue& other) {
+        for (const auto& o : other.items) {
+            PendingComponent& p = touch(o.name);
+            p.occurrences += o.occurrences;
+            for (const auto& f : o.files) addFile(p, f);
+        }
+    }
+
+private:
+    PendingComponent& touch(const std::string& name) {
+        PendingComponent& p = get(name);
+        if (!p.seenThisRun) { p.seenThisRun = true; p.occurrences = 0; p.files.clear(); }
+        return p;
+    }
+    static void addFile(PendingComponent& p, const std::string& fname) {
+        if (std::find(p.files.begin(), p.files.end(), fname) == p.files.end()) p.files.push_back(fname);
+    }
+};
+
+static const std::string kPendingHeader =
+    "Component_Name_Non_Standart;Component_Name_Standart;Delete_0_or_1;Components_File;Occurrences;Files;Suggestions";
+
+#ifndef ALTIUM_CONVERTER_NO_MAIN // только для меню и пакетного режима
+static PendingQueue loadPendingQueue(const std::string& path) {
+    PendingQueue q;
+    CsvReader reader;
+    if (!reader.open(path)) return q;
+    bool first = true;
+    while (reader.next()) {
+        if (first) { first = false; continue; } // заголовок
+        const auto& cells = reader.cells();
+        std::string name = cells.empty() ? "" : std::string(trim_view(cells[0]));
+        if (name.empty()) continue;
+        PendingComponent& p = q.get(name);
+        if (cells.size() > 1) p.standard = std::string(trim_view(cells[1]));
+        if (cells.size() > 2) p.del      = std::string(trim_view(cells[2]));
+        if (cells.size() > 3) p.dbFile   = std::string(trim_view(cells[3]));
+        if (cells.size() > 4) p.occurrences = std::strtoul(std::string(cells[4]).c_str(), nullptr, 10);
+        if (cells.size() > 5) {
+            std::string_view files = cells[5];
+            size_t b = 0;
+            while (b <= files.size()) {
+                size_t e = files.find('|', b);
+                if (e == std::string_view::npos) e = files.size();
+                std::string_view f = trim_view(files.substr(b, e - b));
+                if (!f.empty()) p.files.emplace_back(f);
+                b = e + 1;
+            }
+        }
+        if (cells.size() > 6) p.suggestions = std::string(trim_view(cells[6]));
+    }
+    return q;
+}
+
+// пустая очередь → файл удаляется, чтобы не путать с нерешёнными
+static bool savePendingQueue(const std::string& path, const PendingQueue& q) {
+    if (q.items.empty()) {
+        std::error_code ec; fs::remove(path, ec);
+        return true;
+    }
+    if (fs::path(path).has_parent_path()) fs::create_directories(fs::path(path).parent_path());
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) { std::cerr << "Не удалось создать " << path << "\n"; return false; }
+    out << kPendingHeader << "\n";
+    for (const auto& p : q.items) {
+        std::string files;
+        for (const auto& f : p.files) { if (!files.empty()) files += '|'; files += f; }
+        writeCsvSemicolonRow(out, { p.name, p.standard, p.del, p.dbFile, std::to_string(p.occurrences), files, p.suggestions });
+    }
+    return true;
+}
+
+// убрать из очереди то, что уже появилось в базе, остальным — подобрать похожие
+static void prunePendingQueue(PendingQueue& q, const ComponentDb& dbMap) {
+    PendingQueue left;
+    for (auto& p : q.items)
+        if (!dbMap.contains(p.name)) left.get(p.name) = std::move(p);
+    q = std::move(left);
+
+    if (q.items.empty()) return;
+    const auto index = similarityIndex(dbMap);
+    for (auto& p : q.items) {
+        p.suggestions.clear();
+        for (const auto& m : index->nearest(p.name, kSuggestions)) {
+            if (!p.suggestions.empty()) p.suggestions += '|';
+            p.suggestions += describeSuggestion(m);
+        }
+    }
+}
+#endif
+
+// что делать с компонентом, которого нет в базе: интерактивно добавить (maybeAddComponentToDb)
+// или отложить в очередь; nullopt → строка остаётся как есть
+using UnknownHandler = std::function<std::optional<CompInfo>(const std::string& elem)>;
+
+// -------- Статистика запуска (--stats FILE) --------
+// Счётчики строк ведутся всегда (это несколько инкрементов на строку), часы читаются
+// только если processFile передан FileStats: по одному steady_clock::now() на границе
+// этапов, время этапа = разность соседних отметок.
+enum class Stage : unsigned { Read, Normalize, Lookup, Apply, Write, Count };
+static const char* const kStageNames[] = { "read", "normalize", "lookup", "apply", "write" };
+
+struct FileStats {
+    std::string file;
+    const char* encoding = "UTF-8";     // кодировка входа (см. TextFile)
+    int      rc = 1;
+    uint64_t rows = 0, written = 0, dropped = 0, replaced = 0, unknown = 0;
+    uint64_t bytesIn = 0, bytesOut = 0;
+    uint64_t ns[(unsigned)Stage::Count] = {};
+    uint64_t totalNs = 0;
+};
+
+class StageClock {
+public:
+    using clock = std::chrono::steady_clock;
+    explicit StageClock(FileStats* st) : st_(st) { if (st_) start_ = last_ = clock::now(); }
+
+    // закрыть этап s: время с предыдущей отметки уходит в него
+    void lap(Stage s) {
+        if (!st_) return;
+        const auto now = clock::now();
+        st_->ns[(unsigned)s] += (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(now - last_).count();
+        last_ = now;
+    }
+    // время с предыдущей отметки не относить ни к одному этапу (ожидание других потоков)
+    void skip() { if (st_) last_ = clock::now(); }
+    void finish() {
+        if (st_) st_->totalNs = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start_).count();
+    }
+
+private:
+    FileStats* st_;
+    clock::time_point start_, last_;
+};
+
+struct RunStats {
+    std::string startedAt;              // UTC, ISO 8601
+    unsigned threads = 1;
+    uint64_t dbLoadNs = 0, dbEntries = 0, wallNs = 0;
+    std::vector<FileStats> files;
+};
+
+#ifndef ALTIUM_CONVERTER_NO_MAIN // только для меню и пакетного режима
+static std::string jsonString(const std::string& s) {
+    std::string o = "\"";
+    for (unsigned char c : s) {
+        if (c == '"' || c == '\\') { o.push_back('\\'); o.push_back((char)c); }
+        else if (c < 0x20) { char b[8]; std::snprintf(b, sizeof b, "\\u%04x", c); o += b; }
+        else o.push_back((char)c);
+    }
+    return o + "\"";
+}
+
+static std::string utcTimestamp() {
+    const std::time_t t = std::time(nullptr);
+    std::tm tm{};
+#ifdef _WIN32
+    gmtime_s(&tm, &t);
+#else
+    gmtime_r(&t, &tm);
+#endif
+    char b[32];
+    std::strftime(b, sizeof b, "%Y-%m-%dT%H:%M:%SZ", &tm);
+    return b;
+}
+
+static bool saveRunStats(const std::string& path, const RunStats& run, uint64_t cacheHits, uint64_t cacheMisses) {
+    auto sec = [](uint64_t ns) { std::ostringstream o; o.setf(std::ios::fixed); o.precision(6); o << ns / 1e9; return o.str(); };
+    auto stages = [&](const uint64_t* ns) {
+        std::string o = "{";
+        for (unsigned k = 0; k < (unsigned)Stage::Count; ++k)
+            o += std::string(k ? ", " : "") + "\"" + kStageNames[k] + "\": " + sec(ns[k]);
+        return o + "}";
+    };
+
+    FileStats total;
+    size_t ok = 0;
+    for (const auto& f : run.files) {
+        total.rows += f.rows; total.written += f.written; total.dropped += f.dropped;
+        total.replaced += f.replaced; total.unknown += f.unknown;
+        total.bytesIn += f.bytesIn; total.bytesOut += f.bytesOut;
+        for (unsigned k = 0; k < (unsigned)Stage::Count; ++k) total.ns[k] += f.ns[k];
+        if (f.rc == 0) ++ok;
+    }
+    const double wall = run.wallNs / 1e9;
+
+    std::ostringstream o;
+    o << "{\n"
+      << "  \"started_at\": " << jsonString(run.startedAt) << ",\n"
+      << "  \"threads\": " << run.threads << ",\n"
+      << "  \"wall_s\": " << sec(run.wallNs) << ",\n"
+      << "  \"db\": {\"entries\": " << run.dbEntries << ", \"load_s\": " << sec(run.dbLoadNs) << "},\n"
+      << "  \"cache\": {\"hits\": " << cacheHits << ", \"misses\": " << cacheMisses << "},\n"
+      << "  \"totals\": {\"files\": " << run.files.size() << ", \"ok\": " << ok
+      << ", \"rows\": " << total.rows << ", \"written\": " << total.written << ", \"dropped\": " << total.dropped
+      << ", \"replaced\": " << total.replaced << ", \"unknown\": " << total.unknown
+      << ", \"bytes_in\": " << total.bytesIn << ", \"bytes_out\": " << total.bytesOut
+      << ", \"rows_per_s\": " << (uint64_t)(wall > 0 ? total.rows / wall : 0)
+      << ", \"stages_s\": " << stages(total.ns) << "},\n"
+      << "  \"files\": [";
+    for (size_t i = 0; i < run.files.size(); ++i) {
+        const FileStats& f = run.files[i];
+        o << (i ? ",\n" : "\n")
+          << "    {\"file\": " << jsonString(f.file) << ", \"ok\": " << (f.rc == 0 ? "true" : "false")
+          << ", \"rows\": " << f.rows << ", \"written\": " << f.written << ", \"dropped\": " << f.dropped
+          << ", \"replaced\": " << f.replaced << ", \"unknown\": " << f.unknown
+          << ", \"encoding\": " << jsonString(f.encoding)
+          << ", \"bytes_in\": " << f.bytesIn << ", \"bytes_out\": " << f.bytesOut
+          << ", \"total_s\": " << sec(f.totalNs) << ", \"stages_s\": " << stages(f.ns) << "}";
+    }
+    o << (run.files.empty() ? "]\n}\n" : "\n  ]\n}\n");
+
+    if (fs::path(path).has_parent_path()) fs::create_directories(fs::path(path).parent_path());
+    std::ofstream f(fs::path(path), std::ios::binary | std::ios::trunc);
+    const std::string text = o.str();
+    return f.write(text.data(), (std::streamsize)text.size()) && (f.close(), !f.fail());
+}
+#endif
+
+// какие компоненты файл искал в базе (для манифеста): в порядке первой встречи
+struct FileDeps {
+    struct Use { std::string name; uint64_t count = 0; };
+    std::vector<Use> components;
+    std::unordered_map<std::string, size_t> byKey; // lower(name) → индекс
+
+    void add(const std::string& name, const std::string& key, uint64_t count = 1) {
+        auto [it, inserted] = byKey.emplace(key, components.size());
+        if (inserted) components.push_back({ name, 0 });
+        components[it->second].count += count;
+    }
+};
+
+// -------- Сводка по компонентам (--summary) --------
+// Считается в том же проходе, что и конвертация, по записанным строкам: сколько мест у
+// каждого итогового имени компонента (с позиционными обозначениями), у каждого корпуса и
+// каждого угла поворота. Корпус — первое слово имени, которое есть в таблицах корпусов
+// (@имя = ...) из Settings/Normalize.rules. Сводки файлов сливаются в сводку пакета в
+// порядке файлов, поэтому результат не зависит от числа потоков.
+struct Tally {
+    std::vector<std::pair<std::string, uint64_t>> items; // в порядке первой встречи
+    std::unordered_map<std::string, size_t> index;
+
+    size_t add(const std::string& key, uint64_t n = 1) {
+        auto [it, inserted] = index.emplace(key, items.size());
+        if (inserted) items.emplace_back(key, 0);
+        items[it->second].second += n;
+        return it->second;
+    }
+    // по убыванию количества, при равенстве — по имени
+    std::vector<size_t> ranked() const {
+        std::vector<size_t> order(items.size());
+        for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            return items[a].second != items[b].second ? items[a].second > items[b].second : items[a].first < items[b].first;
+        });
+        return order;
+    }
+};
+
+struct BomSummary {
+    std::string file;
+    bool ok = false;                                    // файл сконвертирован без ошибок
+    uint64_t placements = 0;
+    Tally parts, packages, rotations;
+    std::vector<std::string> partPackage;               // по индексу parts
+    std::vector<std::vector<std::string>> designators;  // по индексу parts
+
+    void addRow(const std::vector<std::string>& cells, const ConversionRules& rules) {
+        if (cells.size() <= rules.componentColumn) return;
+        const std::string name(trim_view(cells[rules.componentColumn]));
+        const std::string designator = cells.size() > rules.designatorColumn ? std::string(trim_view(cells[rules.designatorColumn])) : "";
+        const std::string rotation = cells.size() > rules.rotationColumn ? std::string(trim_view(cells[rules.rotationColumn])) : "";
+        ++placements;
+        const size_t k = parts.add(name);
+        if (k == partPackage.size()) { partPackage.push_back(packageOf(name, rules)); designators.emplace_back(); }
+        if (!designator.empty()) designators[k].push_back(designator);
+        packages.add(partPackage[k]);
+        rotations.add(rotation);
+    }
+
+    void merge(const BomSummary& o) {
+        placements += o.placements;
+        for (size_t i = 0; i < o.parts.items.size(); ++i) {
+            const size_t k = parts.add(o.parts.items[i].first, o.parts.items[i].second);
+            if (k == partPackage.size()) { partPackage.push_back(o.partPackage[i]); designators.emplace_back(); }
+            designators[k].insert(designators[k].end(), o.designators[i].begin(), o.designators[i].end());
+        }
+        for (const auto& [key, n] : o.packages.items)  packages.add(key, n);
+        for (const auto& [key, n] : o.rotations.items) rotations.add(key, n);
+    }
+
+    static std::string packageOf(const std::string& name, const ConversionRules& rules) {
+        size_t b = 0;
+        while (b < name.size()) {
+            size_t e = name.find_first_of("- _", b);
+            if (e == std::string::npos) e = name.size();
+            std::string word = name.substr(b, e - b);
+            if (!word.empty() && rules.packages.count(tolower_copy(word))) return word;
+            b = e + 1;
+        }
+        return "";
+    }
+};
+
+// сводка по уже сконвертированному файлу (для файлов, пропущенных по манифесту)
+static bool summarizeConverted(const std::string& path, BomSummary& sum) {
+    CsvReader in;
+    if (!in.open(path)) return false;
+    std::vector<std::string> cells;
+    while (in.next()) {
+        const auto& row = in.cells();
+        cells.assign(row.begin(), row.end());
+        sum.addRow(cells, gRules);
+    }
+    return true;
+}
+
+#ifndef ALTIUM_CONVERTER_NO_MAIN // только для меню и пакетного режима
+// board.csv → board.summary.csv: Component;Package;Count;Designators
+static std::string summaryPath(const std::string& outPath) {
+    return fs::path(outPath).replace_extension().string() + ".summary.csv";
+}
+
+static bool saveSummaryCsv(const std::string& path, const BomSummary& sum) {
+    CsvWriter out(Quoting::Full);
+    if (!out.open(path, gAtomicWrites)) { std::cerr << "Не удалось создать " << path << "\n"; return false; }
+    out.writeRow(std::vector<std::string>{ "Component", "Package", "Count", "Designators" });
+    for (size_t k : sum.parts.ranked()) {
+        std::string des;
+        for (const auto& d : sum.designators[k]) { if (!des.empty()) des += ", "; des += d; }
+        out.writeRow(std::vector<std::string>{ sum.parts.items[k].first, sum.partPackage[k],
+                                               std::to_string(sum.parts.items[k].second), des });
+    }
+    if (!out.commit()) { std::cerr << "Ошибка записи " << path << "\n"; return false; }
+    return true;
+}
+
+// Summary.json: по каждому файлу и в сумме — места, компоненты (с корпусом), корпуса, повороты
+static bool saveSummaryJson(const std::string& path, const std::vector<BomSummary>& files, const BomSummary& total) {
+    auto tally = [](const Tally& t) {
+        std::string o = "{";
+        bool first = true;
+        for (size_t k : t.ranked()) {
+            o += std::string(first ? "" : ", ") + jsonString(t.items[k].first) + ": " + std::to_string(t.items[k].second);
+            first = false;
+        }
+        return o + "}";
+    };
+    auto block = [&](const BomSummary& s, const std::string& indent) {
+        std::string o = indent + "\"placements\": " + std::to_string(s.placements) + ",\n" + indent + "\"parts\": [";
+        bool first = true;
+        for (size_t k : s.parts.ranked()) {
+            o += std::string(first ? "\n" : ",\n") + indent + "  {\"name\": " + jsonString(s.parts.items[k].first) +
+                 ", \"package\": " + jsonString(s.partPackage[k]) + ", \"count\": " + std::to_string(s.parts.items[k].second) + "}";
+            first = false;
+        }
+        o += std::string(first ? "" : "\n" + indent) + "],\n";
+        o += indent + "\"packages\": " + tally(s.packages) + ",\n";
+        o += indent + "\"rotations\": " + tally(s.rotations) + "\n";
+        return o;
+    };
+    std::string j = "{\n  \"files\": [";
+    for (size_t i = 0; i < files.size(); ++i)
+        j += std::string(i ? ", " : "") + "{\n    \"file\": " + jsonString(files[i].file) + ",\n" + block(files[i], "    ") + "  }";
+    j += "],\n  \"total\": {\n" + block(total, "    ") + "  }\n}\n";
+
+    CsvWriter out(Quoting::Full);                       // временный файл + rename, как у результатов
+    if (!out.open(path, gAtomicWrites)) { std::cerr << "Не удалось создать " << path << "\n"; return false; }
+    out.writeRaw(j);
+    if (!out.commit()) { std::cerr << "Ошибка записи " << path << "\n"; return false; }
+    return true;
+}
+
+// --summary: board.summary.csv рядом с каждым результатом и общий Summary.json в outDir
+// (файлы с ошибкой конвертации пропускаются)
+static bool saveBatchSummaries(const std::string& outDir, const std::vector<BomSummary>& summaries) {
+    std::vector<BomSummary> written;
+    BomSummary total;
+    bool ok = true;
+    for (const auto& s : summaries) {
+        if (!s.ok) continue;
+        ok = saveSummaryCsv(summaryPath(outputPath(outDir, s.file)), s) && ok;
+        total.merge(s);
+        written.push_back(s);
+    }
+    return saveSummaryJson((fs::path(outDir) / "Summary.json").string(), written, total) && ok;
+}
+#endif
+
+// -------- Колоночный файл размещения (--columnar) --------
+// Рядом с результатом board.csv пишется board.cols — те же записанные строки, разложенные
+// по столбцам, чтобы следующие программы (расстановка питателей, АОИ) загружали плату
+// одним mmap без разбора текста. Строка i в .cols — строка i в .csv. Числа — в порядке
+// байт машины (x86/ARM — little-endian), каждый столбец начинается с кратного 8 смещения:
+//
+//   ColumnarHeader (64 байта)        magic "ACPLCOLS", version, columnCount, rowCount,
+//                                    dictCount, columnsOffset, totalSize
+//   ColumnarColumn[columnCount]      id, type, offset, size (байт), count (элементов)
+//   данные столбцов:
+//     Designator  Strings  rowCount   uint32 offsets[count + 1], затем байты UTF-8;
+//                                     строка i — [offsets[i], offsets[i + 1]) от начала байтов
+//     X, Y        Float64  rowCount   double; единицы как в файле, не число — NaN
+//     Rotation    Float32  rowCount   float; не число — NaN
+//     Component   UInt32   rowCount   номер в словаре; kColumnarNoComponent — в строке нет столбца
+//     Dictionary  Strings  dictCount  имена компонентов в записанном виде (стандарт из базы или как есть)
+//     DictFlags   UInt8    dictCount  бит 0 (kColumnarInDb) — имя найдено в базе компонентов
+// Номера словаря — свои у каждого файла (в порядке первого появления): у записей базы
+// нет постоянных номеров, а имя из словаря ищется в базе так же, как ячейка CSV.
+// Незнакомые id столбцов читатель пропускает — новые столбцы не ломают старых читателей.
+static constexpr char     kColumnarMagic[8] = { 'A','C','P','L','C','O','L','S' };
+static constexpr uint32_t kColumnarVersion  = 1;
+static constexpr uint32_t kColumnarNoComponent = UINT32_MAX;
+static constexpr uint8_t  kColumnarInDb = 1;
+
+enum class ColumnarId   : uint32_t { Designator = 1, X, Y, Rotation, Component, Dictionary, DictFlags };
+enum class ColumnarType : uint32_t { Strings = 1, Float64, Float32, UInt32, UInt8 };
+
+struct ColumnarHeader {
+    char     magic[8];
+    uint32_t version;
+    uint32_t columnCount;
+    uint64_t rowCount;
+    uint64_t dictCount;
+    uint64_t columnsOffset;
+    uint64_t totalSize;
+    uint64_t reserved[2];
+};
+struct ColumnarColumn { uint32_t id, type; uint64_t offset, size, count; };
+static_assert(sizeof(ColumnarHeader) == 64 && sizeof(ColumnarColumn) == 32, "раскладка .cols");
+
+// board.csv → board.cols
+static std::string columnarPath(const std::string& outPath) {
+    return fs::path(outPath).replace_extension(".cols").string();
+}
+
+// число из ячейки: "12,5" = "12.5", суффикс единиц ("12.5mm") отбрасывается; иначе NaN
+static double columnarNumber(std::string_view cell) {
+    std::string t(trim_view(cell));
+    std::replace(t.begin(), t.end(), ',', '.');
+    char* end = nullptr;
+    const double d = std::strtod(t.c_str(), &end);
+    return end == t.c_str() ? std::numeric_limits<double>::quiet_NaN() : d;
+}
+
+// столбцы записанных строк одного блока (не больше kColumnarBlockRows строк или блок конвейера);
+// блоки по порядку отдаются ColumnarWriter::add
+struct PlacementColumns {
+    std::vector<uint32_t> designatorOffsets{ 0 };
+    std::string designators;
+    std::vector<double> x, y;
+    std::vector<float> rotation;
+    std::vector<uint32_t> component;
+    std::vector<std::string> dict;
+    std::vector<uint8_t> dictFlags;
+    std::unordered_map<std::string, uint32_t> dictIndex;
+
+    size_t rows() const { return component.size(); }
+
+    // inDb — компонент строки найден в базе (или только что в неё добавлен)
+    void addRow(const std::vector<std::string>& cells, const ConversionRules& rules, bool inDb) {
+        auto cell = [&](size_t i) { return i < cells.size() ? trim_view(cells[i]) : std::string_view(); };
+        designators.append(cell(rules.designatorColumn));
+        designatorOffsets.push_back((uint32_t)designators.size());
+        x.push_back(columnarNumber(cell(rules.xColumn)));
+        y.push_back(columnarNumber(cell(rules.yColumn)));
+        rotation.push_back((float)columnarNumber(cell(rules.rotationColumn)));
+        component.push_back(cells.size() > rules.componentColumn
+                                ? intern(std::string(cell(rules.componentColumn)), inDb ? kColumnarInDb : 0)
+                                : kColumnarNoComponent);
+    }
+
+private:
+    uint32_t intern(const std::string& name, uint8_t flags) {
+        auto [it, inserted] = dictIndex.emplace(name, (uint32_t)dict.size());
+        if (inserted) { dict.push_back(name); dictFlags.push_back(0); }
+        dictFlags[it->second] |= flags;
+        return it->second;
+    }
+};
+
+static constexpr size_t kColumnarBlockRows = 4096;
+
+// Запись board.cols без накопления всего файла в памяти: столбцы каждого блока сразу
+// дописываются каждый в свой временный файл рядом с результатом (uniqueTempPath), в памяти
+// остаётся только словарь имён компонентов. commit() собирает заголовок и столбцы в board.cols
+// (временный файл + fsync + rename, как у результатов); без commit() временные файлы удаляются.
+class ColumnarWriter {
+public:
+    explicit ColumnarWriter(std::string path) : path_(std::move(path)) {}
+    ColumnarWriter(const ColumnarWriter&) = delete;
+    ColumnarWriter& operator=(const ColumnarWriter&) = delete;
+    ~ColumnarWriter() { abandon(); }
+
+    size_t rows() const { return rows_; }
+
+    void add(const PlacementColumns& b) {
+        if (!ok_ || !b.rows()) return;
+        if (spill_[0].path.empty() && !start()) return;
+        if (b.designators.size() > UINT32_MAX - designatorBytes_) { ok_ = false; tooBig_ = true; return; }
+
+        std::vector<uint32_t> v(b.designatorOffsets.begin() + 1, b.designatorOffsets.end());
+        for (auto& o : v) o += (uint32_t)designatorBytes_;          // смещения — от начала всех байтов
+        put(DesignatorOffsets, v);
+        put(Designators, b.designators.data(), b.designators.size());
+        put(X, b.x);
+        put(Y, b.y);
+        put(Rotation, b.rotation);
+        std::vector<uint32_t> remap(b.dict.size());                 // словарь блока → словарь файла
+        for (size_t k = 0; k < b.dict.size(); ++k) remap[k] = intern(b.dict[k], b.dictFlags[k]);
+        for (size_t i = 0; i < b.component.size(); ++i)
+            v[i] = b.component[i] == kColumnarNoComponent ? kColumnarNoComponent : remap[b.component[i]];
+        put(Component, v);
+        designatorBytes_ += b.designators.size();
+        rows_ += b.rows();
+    }
+
+    // false — ошибка уже напечатана
+    bool commit() {
+        if (spill_[0].path.empty()) start();                        // пустой результат — тоже .cols
+        for (auto& sp : spill_) { sp.out.close(); ok_ = ok_ && !sp.out.fail(); }
+        std::vector<uint32_t> dictOffsets{ 0 };
+        std::string dictChars;
+        for (const auto& name : dict_) { dictChars += name; dictOffsets.push_back((uint32_t)dictChars.size()); }
+        if (tooBig_ || dictChars.size() > UINT32_MAX) {
+            std::cerr << "Слишком большой файл для " << path_ << "\n";
+            abandon();
+            return false;
+        }
+        if (!ok_) { std::cerr << "Ошибка записи " << path_ << "\n"; abandon(); return false; }
+
+        // кусок столбца: временный файл или данные в памяти
+        struct Chunk { const Spill* file; std::string_view mem; uint64_t size() const { return file ? file->bytes : mem.size(); } };
+        struct Part { ColumnarId id; ColumnarType type; uint64_t count; std::vector<Chunk> chunks; };
+        auto bytes = [](const auto& v) { return Chunk{ nullptr, std::string_view((const char*)v.data(), v.size() * sizeof(v[0])) }; };
+        auto file  = [&](SpillId k) { return Chunk{ &spill_[k], {} }; };
+        const Part parts[] = {
+            { ColumnarId::Designator, ColumnarType::Strings, rows_,        { file(DesignatorOffsets), file(Designators) } },
+            { ColumnarId::X,          ColumnarType::Float64, rows_,        { file(X) } },
+            { ColumnarId::Y,          ColumnarType::Float64, rows_,        { file(Y) } },
+            { ColumnarId::Rotation,   ColumnarType::Float32, rows_,        { file(Rotation) } },
+            { ColumnarId::Component,  ColumnarType::UInt32,  rows_,        { file(Component) } },
+            { ColumnarId::Dictionary, ColumnarType::Strings, dict_.size(), { bytes(dictOffsets), bytes(dictChars) } },
+            { ColumnarId::DictFlags,  ColumnarType::UInt8,   dict_.size(), { bytes(dictFlags_) } },
+        };
+        constexpr uint32_t count = sizeof parts / sizeof parts[0];
+        auto align8 = [](uint64_t v) { return (v + 7) & ~uint64_t(7); };
+
+        ColumnarHeader h{};
+        std::memcpy(h.magic, kColumnarMagic, sizeof h.magic);
+        h.version       = kColumnarVersion;
+        h.columnCount   = count;
+        h.rowCount      = rows_;
+        h.dictCount     = dict_.size();
+        h.columnsOffset = sizeof h;
+
+        std::vector<ColumnarColumn> dir(count);
+        uint64_t at = align8(h.columnsOffset + count * sizeof(ColumnarColumn));
+        for (uint32_t c = 0; c < count; ++c) {
+            uint64_t size = 0;
+            for (const auto& ch : parts[c].chunks) size += ch.size();
+            dir[c] = { (uint32_t)parts[c].id, (uint32_t)parts[c].type, at, size, parts[c].count };
+            at = align8(at + size);
+        }
+        h.totalSize = at;
+
+        CsvWriter out(Quoting::Full);
+        if (!out.open(path_, gAtomicWrites)) { std::cerr << "Не удалось создать " << path_ << "\n"; abandon(); return false; }
+        const std::string zeros(8, '\0');
+        out.writeRaw(std::string_view((const char*)&h, sizeof h));
+        out.writeRaw(std::string_view((const char*)dir.data(), dir.size() * sizeof(ColumnarColumn)));
+        std::string buf;
+        bool copied = true;
+        for (uint32_t c = 0; c < count; ++c) {
+            out.writeRaw(std::string_view(zeros).substr(0, (size_t)(dir[c].offset - out.bytes())));
+            for (const auto& ch : parts[c].chunks) {
+                if (!ch.file) { out.writeRaw(ch.mem); continue; }
+                std::ifstream in(fs::path(ch.file->path), std::ios::binary);
+                buf.resize(1 << 20);
+                for (uint64_t left = ch.file->bytes; left > 0 && copied;) {
+                    const size_t n = (size_t)std::min<uint64_t>(left, buf.size());
+                    copied = (bool)in.read(&buf[0], (std::streamsize)n);
+                    out.writeRaw(std::string_view(buf.data(), n));
+                    left -= n;
+                }
+            }
+        }
+        out.writeRaw(std::string_view(zeros).substr(0, (size_t)(h.totalSize - out.bytes())));
+        if (!copied) out.abandon();
+        const bool committed = copied && out.commit();
+        abandon();
+        if (!committed) { std::cerr << "Ошибка записи " << path_ << "\n"; return false; }
+        return true;
+    }
+
+private:
+    enum SpillId { DesignatorOffsets, Designators, X, Y, Rotation, Component, SpillCount };
+    struct Spill { std::string path; std::ofstream out; uint64_t bytes = 0; };
+
+    bool start() {
+        for (auto& sp : spill_) {
+            sp.path = uniqueTempPath(path_);
+            sp.out.open(fs::path(sp.path), std::ios::binary | std::ios::trunc);
+            if (!sp.out) { ok_ = false; return false; }
+        }
+        put(DesignatorOffsets, std::vector<uint32_t>{ 0 });
+        return ok_;
+    }
+
+    void put(SpillId k, const void* data, size_t size) {
+        ok_ = ok_ && (bool)spill_[k].out.write((const char*)data, (std::streamsize)size);
+        spill_[k].bytes += size;
+    }
+    template <class T> void put(SpillId k, const std::vector<T>& v) { put(k, v.data(), v.size() * sizeof(T)); }
+
+    uint32_t intern(const std::string& name, uint8_t flags) {
+        auto [it, inserted] = dictIndex_.emplace(name, (uint32_t)dict_.size());
+        if (inserted) { dict_.push_back(name); dictFlags_.push_back(0); }
+        dictFlags_[it->second] |= flags;
+        return it->second;
+    }
+
+    void abandon() {
+        for (auto& sp : spill_) {
+            if (sp.out.is_open()) sp.out.close();
+            if (!sp.path.empty()) { std::error_code ec; fs::remove(sp.path, ec); sp.path.clear(); }
+        }
+    }
+
+    std::string path_;
+    Spill spill_[SpillCount];
+    uint64_t rows_ = 0, designatorBytes_ = 0;
+    std::vector<std::string> dict_;
+    std::vector<uint8_t> dictFlags_;
+    std::unordered_map<std::string, uint32_t> dictIndex_;
+    bool ok_ = true, tooBig_ = false;
+};
+
+// Чтение board.cols для встраивающих программ: файл отображается в память, open() проверяет
+// заголовок, границы столбцов и смещения строк, дальше доступ — прямо по указателям.
+class PlacementColumnsView {
+public:
+    bool open(const std::string& path) {
+        rows_ = dictCount_ = 0;
+        if (!file_.open(path) || file_.size() < sizeof(ColumnarHeader)) return false;
+        const char* base = file_.data();
+        ColumnarHeader h;
+        std::memcpy(&h, base, sizeof h);
+        if (std::memcmp(h.magic, kColumnarMagic, sizeof h.magic) != 0 || h.version != kColumnarVersion) return false;
+        if (h.totalSize != file_.size() || h.columnsOffset + (uint64_t)h.columnCount * sizeof(ColumnarColumn) > h.totalSize)
+            return false;
+
+        auto find = [&](ColumnarId id, ColumnarType type, uint64_t count, uint64_t elem) -> const char* {
+            for (uint32_t c = 0; c < h.columnCount; ++c) {
+                ColumnarColumn col;
+                std::memcpy(&col, base + h.columnsOffset + c * sizeof col, sizeof col);
+                if (col.id != (uint32_t)id) continue;
+                if (col.type != (uint32_t)type || col.count != count || col.offset % 8 != 0) return nullptr;
+                if (col.offset > h.totalSize || col.size > h.totalSize - col.offset) return nullptr;
+                if (type == ColumnarType::Strings) {
+                    const uint64_t head = (count + 1) * sizeof(uint32_t);
+                    if (col.size < head) return nullptr;
+                    const uint32_t* off = (const uint32_t*)(base + col.offset);
+                    for (uint64_t i = 0; i < count; ++i) if (off[i] > off[i + 1]) return nullptr;
+                    if (off[0] != 0 || off[count] > col.size - head) return nullptr;
+                } else if (col.size != count * elem) {
+                    return nullptr;
+                }
+                return base + col.offset;
+            }
+            return nullptr;
+        };
+        const char* des   = find(ColumnarId::Designator, ColumnarType::Strings, h.rowCount, 0);
+        const char* xs    = find(ColumnarId::X,          ColumnarType::Float64, h.rowCount, sizeof(double));
+        const char* ys    = find(ColumnarId::Y,          ColumnarType::Float64, h.rowCount, sizeof(double));
+        const char* rot   = find(ColumnarId::Rotation,   ColumnarType::Float32, h.rowCount, sizeof(float));
+        const char* comp  = find(ColumnarId::Component,  ColumnarType::UInt32,  h.rowCount, sizeof(uint32_t));
+        const char* dict  = find(ColumnarId::Dictionary, ColumnarType::Strings, h.dictCount, 0);
+        const char* flags = find(ColumnarId::DictFlags,  ColumnarType::UInt8,   h.dictCount, 1);
+        if (!des || !xs || !ys || !rot || !comp || !dict || !flags) return false;
+
+        desOff_   = (const uint32_t*)des;
+        desChars_ = des + (h.rowCount + 1) * sizeof(uint32_t);
+        x_ = (const double*)xs;
+        y_ = (const double*)ys;
+        rot_  = (const float*)rot;
+        comp_ = (const uint32_t*)comp;
+        dictOff_   = (const uint32_t*)dict;
+        dictChars_ = dict + (h.dictCount + 1) * sizeof(uint32_t);
+        flags_ = (const uint8_t*)flags;
+        for (uint64_t i = 0; i < h.rowCount; ++i)
+            if (comp_[i] >= h.dictCount && comp_[i] != kColumnarNoComponent) return false;
+        rows_ = (size_t)h.rowCount;
+        dictCount_ = (size_t)h.dictCount;
+        return true;
+    }
+
+    size_t rows()     const { return rows_; }
+    size_t dictSize() const { return dictCount_; }
+
+    std::string_view designator(size_t i) const { return { desChars_ + desOff_[i], desOff_[i + 1] - desOff_[i] }; }
+    double   x(size_t i)           const { return x_[i]; }
+    double   y(size_t i)           const { return y_[i]; }
+    float    rotation(size_t i)    const { return rot_[i]; }
+    uint32_t componentId(size_t i) const { return comp_[i]; }
+    // имя компонента строки; "" — в строке не было столбца компонента
+    std::string_view component(size_t i) const { return comp_[i] == kColumnarNoComponent ? std::string_view() : dictName(comp_[i]); }
+
+    std::string_view dictName(uint32_t id) const { return { dictChars_ + dictOff_[id], dictOff_[id + 1] - dictOff_[id] }; }
+    bool inDb(uint32_t id) const { return (flags_[id] & kColumnarInDb) != 0; }
+
+private:
+    MappedFile file_;
+    size_t rows_ = 0, dictCount_ = 0;
+    const uint32_t* desOff_ = nullptr;
+    const char*     desChars_ = nullptr;
+    const double*   x_ = nullptr;
+    const double*   y_ = nullptr;
+    const float*    rot_ = nullptr;
+    const uint32_t* comp_ = nullptr;
+    const uint32_t* dictOff_ = nullptr;
+    const char*     dictChars_ = nullptr;
+    const uint8_t*  flags_ = nullptr;
+};
+
+// правило поворота и нормализация всех ячеек строки; возвращает ключ для сверки с базой
+// (N(x) столбца компонента, в строку уходит N(N(x)) — см. ниже)
+static std::string prepareRow(std::vector<std::string>& cells, const ConversionRules& rules) {
+    // === правило поворота (по умолчанию C*/R* в 4-м столбце), по исходному тексту ===
+    if (cells.size() > rules.rotationColumn && cells.size() > rules.designatorColumn &&
+        !cells[rules.designatorColumn].empty()) {
+        char first = std::toupper(static_cast<unsigned char>(cells[rules.designatorColumn][0]));
+        if (rules.rotatePrefixes.find(first) != std::string::npos) {
+            std::string rot = trim(cells[rules.rotationColumn]);
+            for (const auto& [from, to] : rules.rotateMap)
+                if (rot == from) { cells[rules.rotationColumn] = to; break; }
+        }
+    }
+
+    // === нормализация: один проход на ячейку ===
+    // каждый 5-й столбец исторически нормализуется дважды (до сверки с базой и при записи),
+    // поэтому в выходной файл идёт N(N(x)), остальные — N(x); ключ для базы = N(x).
+    // Через кэш — только столбец компонента и столбцы-точки, остальные почти не повторяются.
+    // normalizeCell уже заканчивается fixCyrillicLetters, отдельный вызов не нужен.
+    std::string compKey;
+    for (size_t i = 0; i < cells.size(); ++i) {
+        const bool point = rules.isPointColumn(i);
+        if (i == rules.componentColumn) {
+            normalizeCellCached(cells[i], compKey, rules);
+            if (point) normalizeCellCached(compKey, cells[i], rules);
+            else       cells[i] = compKey;
+        } else if (point) {
+            normalizeCellCached(cells[i], cells[i], rules);
+            normalizeCellCached(cells[i], cells[i], rules);
+        } else {
+            cells[i] = normalizeCell(cells[i], rules);
+        }
+    }
+    return compKey;
+}
+
+// запись базы для строки: true — строку удалить, иначе (если есть стандарт) заменить имя
+static bool applyDbEntry(std::vector<std::string>& cells, const ConversionRules& rules, bool toDelete,
+                         std::string_view standard, std::string& scratch, FileStats& st) {
+    if (toDelete) return true;
+    if (!standard.empty()) {
+        scratch.assign(standard.data(), standard.size());
+        normalizeCellCached(scratch, cells[rules.componentColumn], rules); // заменить на стандарт
+        ++st.replaced;
+    }
+    return false;
+}
+
+// Строки из r (CsvReader или RowReader) → готовый CSV в конец out, без вопросов: неизвестные
+// компоненты дописываются в unknown в порядке строк. Общая часть конвейера (блоки) и
+// ConversionEngine (буферы); cells/stdName — переиспользуемые буферы вызывающего.
+// flushAt — вернуться, как только в out набралось столько байт: true — строки ещё есть,
+// вызывающий сбрасывает out в файл и вызывает снова.
+template <class Reader>
+static bool convertRows(Reader& r, const ComponentDb& dbMap, const ConversionRules& rules,
+                        std::string& out, std::vector<std::string>& unknown, FileStats& st, StageClock& clk,
+                        std::vector<std::string>& cells, std::string& stdName,
+                        FileDeps* deps = nullptr, BomSummary* summary = nullptr,
+                        PlacementColumns* columns = nullptr, size_t flushAt = SIZE_MAX) {
+    while (r.next()) {
+        const auto& row = r.cells();
+        cells.resize(row.size());
+        for (size_t i = 0; i < row.size(); ++i) cells[i].assign(row[i].data(), row[i].size());
+        ++st.rows;
+        clk.lap(Stage::Read);
+
+        const std::string compKey = prepareRow(cells, rules);
+        clk.lap(Stage::Normalize);
+
+        bool drop_line = false, inDb = false;
+        if (cells.size() > rules.componentColumn) {
+            const std::string_view elem = trim_view(compKey);
+            const ComponentDb::Ref* info = dbMap.find(elem);
+            if (deps) deps->add(std::string(elem), tolower_copy(std::string(elem)));
+            clk.lap(Stage::Lookup);
+            if (info) {
+                inDb = true;
+                drop_line = applyDbEntry(cells, rules, info->to_delete, info->standard, stdName, st);
+            } else {
+                ++st.unknown;
+                unknown.emplace_back(elem);
+            }
+            clk.lap(Stage::Apply);
+        }
+        if (drop_line) { ++st.dropped; continue; }
+
+        if (summary) summary->addRow(cells, rules);
+        if (columns) columns->addRow(cells, rules, inDb);
+        appendCsvRow(out, cells, Quoting::Minimal);
+        ++st.written;
+        clk.lap(Stage::Write);
+        if (out.size() >= flushAt) return true;
+    }
+    return false;
+}
+
+// dbMap только читается — один индекс на все потоки пакетной конвертации
+// (интерактивный обработчик может дописать в него новый компонент сам)
+// stats (необязательно) — счётчики строк и время по этапам, см. FileStats;
+// deps (необязательно) — найденные/ненайденные компоненты, см. ConversionManifest;
+// summary (необязательно) — сводка по записанным строкам, см. BomSummary;
+// columns (необязательно) — записанные строки по столбцам для board.cols, см. ColumnarWriter
+// (commit() — за вызывающим, после результата)
+static int processFile(const std::string& pathIn, const std::string& pathOut, bool verbose,
+                       const ComponentDb& dbMap, const UnknownHandler& onUnknown,
+                       FileStats* stats = nullptr, FileDeps* deps = nullptr, BomSummary* summary = nullptr,
+                       ColumnarWriter* columns = nullptr) {
+    FileStats local;
+    FileStats& st = stats ? *stats : local;
+    st.file = pathIn;
+    StageClock clk(stats);
+
+    RowReader in; // CSV или XLSX
+    if (!in.open(pathIn)) { std::cerr << "Не удалось открыть " << pathIn << "\n"; return st.rc = 1; }
+    st.bytesIn = in.bytes();
+    st.encoding = encodingName(in.encoding());
+    if (verbose && in.encoding() != TextEncoding::Utf8) std::cout << "Кодировка " << st.encoding << " → UTF-8\n";
+
+    fs::create_directories(fs::path(pathOut).parent_path());
+    CsvWriter out(Quoting::Minimal);
+    if (!out.open(pathOut, gAtomicWrites)) { std::cerr << "Не удалось создать " << pathOut << "\n"; return st.rc = 1; }
+    clk.lap(Stage::Write);
+
+    const ConversionRules& rules = gRules;
+    std::vector<std::string> cells; // строки ячеек переиспользуются от строки к строке
+    std::string stdName;
+    PlacementColumns block;         // строки для columns — блоками по kColumnarBlockRows
+    while (in.next()) {
+        const auto& row = in.cells();
+        cells.resize(row.size());
+        for (size_t i = 0; i < row.size(); ++i) cells[i].assign(row[i].data(), row[i].size());
+        ++st.rows;
+        clk.lap(Stage::Read);
+
+        const std::string compKey = prepareRow(cells, rules);
+        clk.lap(Stage::Normalize);
+
         // вывод (опционально)
         if (verbose) {
             for (size_t i = 0; i < cells.size(); ++i)
@@ -489,85 +4183,768 @@ static int processFile(const std::string& pathIn, const std::string& pathOut, bo
             std::cout << "-------------------\n";
         }
 
-        // === Сверка 5-го столбца с базой + интерактив для новых ===
-        bool drop_line = false;
-        if (cells.size() > 4) {
-            std::string elem = trim(cells[4]);        // уже нормализован и латинизирован (normalizeCell в конце вызывает fixCyrillicLetters)
-            std::string key  = tolower_copy(elem);
-
-            auto it = dbMap.find(key);
-            if (it != dbMap.end()) {
-                const CompInfo& info = it->second;
-                if (info.to_delete) {
-                    drop_line = true;                 // удалить строку
-                } else if (!info.standard.empty()) {
-                    cells[4] = info.standard;         // заменить на стандарт
-                }
-            } else {
-                // новый компонент → спросить, добавить ли
-                if (auto added = maybeAddComponentToDb(elem, dbMap)) {
-                    if (added->to_delete) {
-                        drop_line = true;             // если пользователь отметил удалять — удаляем эту же строку
-                    } else if (!added->standard.empty()) {
-                        cells[4] = added->standard;   // иначе заменяем на новый стандарт
-                    }
-                } else {
-                    // пользователь отказался добавлять — оставляем как есть
-                }
+        // === Сверка 5-го столбца с базой + интерактив для новых ===
+        bool drop_line = false, inDb = false;
+        if (cells.size() > rules.componentColumn) {
+            // уже нормализован и латинизирован (normalizeCell в конце вызывает fixCyrillicLetters);
+            // поиск без учёта регистра прямо по string_view — без копий
+            const std::string_view elem = trim_view(compKey);
+
+            const ComponentDb::Ref* info = dbMap.find(elem);
+            if (deps) deps->add(std::string(elem), tolower_copy(std::string(elem)));
+            clk.lap(Stage::Lookup);
+            if (info) {
+                inDb = true;
+                drop_line = applyDbEntry(cells, rules, info->to_delete, info->standard, stdName, st);
+            } else {
+                ++st.unknown;
+                // новый компонент → спросить, добавить ли (или отложить в очередь);
+                // если пользователь отметил удалять — удаляем эту же строку, иначе заменяем на новый стандарт
+                if (auto added = onUnknown(std::string(elem))) {
+                    inDb = true;
+                    drop_line = applyDbEntry(cells, rules, added->to_delete, added->standard, stdName, st);
+                }
+                // nullopt — пользователь отказался добавлять, оставляем как есть
+            }
+            clk.lap(Stage::Apply);
+        }
+
+if (drop_line) {
+    ++st.dropped;
+    if (verbose) std::cout << "↑ строка удалена по правилу базы\n"
+                           << "-------------------\n";
+    continue; // НЕ записывать строку
+}
+
+        // запись строки в выходной CSV с ';' (в кавычки — только то, что иначе не прочитать обратно)
+        if (summary) summary->addRow(cells, rules);
+        if (columns) {
+            block.addRow(cells, rules, inDb);
+            if (block.rows() >= kColumnarBlockRows) { columns->add(block); block = PlacementColumns(); }
+        }
+        out.writeRow(cells);
+        ++st.written;
+        clk.lap(Stage::Write);
+    }
+    if (in.failed()) return st.rc = 1;  // повреждённый лист XLSX: половину результата не публикуем
+    if (columns) columns->add(block);
+    st.bytesOut = out.bytes();
+    const bool committed = out.commit();
+    clk.lap(Stage::Write);
+    clk.finish();
+    if (!committed) { std::cerr << "Ошибка записи " << pathOut << "\n"; return st.rc = 1; }
+    return st.rc = 0;
+}
+
+
+// -------- Конвейер для одного большого файла --------
+// Один файл с миллионами строк не ускоряется параллелизмом по файлам, поэтому он режется
+// на блоки по границам записей: текущий поток только находит границы в байтах файла
+// (rawRecordEnd — memchr по '\n' и '"', без разбора ячеек) и пишет готовые блоки строго
+// по порядку, рабочие потоки перекодируют (CP1251/UTF-16), разбирают, нормализуют и сверяют
+// с базой каждый свой блок. В работе не больше 2×threads+2 блоков — память не зависит
+// от размера файла, в том числе с --columnar: столбцы каждого блока сразу уходят во временные
+// файлы ColumnarWriter. Строки собираются тем же convertRows (prepareRow/applyDbEntry/
+// appendCsvRow), неизвестные и deps — в порядке строк, поэтому результат побайтно совпадает
+// с processFile.
+static constexpr size_t kPipelineMinBytes  = 4u << 20; // файлы меньше — последовательно
+static constexpr size_t kPipelineBlockRows = 4096;
+
+// onUnknown только регистрирует компонент (в базу из рабочих потоков ничего не добавляется)
+static int processFilePipelined(const std::string& pathIn, const std::string& pathOut,
+                                const ComponentDb& dbMap, const std::function<void(const std::string&)>& onUnknown,
+                                unsigned threads, FileStats* stats = nullptr, FileDeps* deps = nullptr,
+                                BomSummary* summary = nullptr, ColumnarWriter* columns = nullptr) {
+    FileStats local;
+    FileStats& st = stats ? *stats : local;
+    st.file = pathIn;
+    StageClock clk(stats);
+
+    TextFile in;
+    if (!in.open(pathIn)) { std::cerr << "Не удалось открыть " << pathIn << "\n"; return st.rc = 1; }
+    st.bytesIn = in.size();
+    st.encoding = encodingName(in.encoding());
+    const TextEncoding enc = in.encoding();
+    const char* pos = in.data() + in.bom();
+    const char* const end = in.data() + in.size();
+
+    fs::create_directories(fs::path(pathOut).parent_path());
+    CsvWriter out(Quoting::Minimal);
+    if (!out.open(pathOut, gAtomicWrites)) { std::cerr << "Не удалось создать " << pathOut << "\n"; return st.rc = 1; }
+    clk.lap(Stage::Write);
+
+    struct Block {
+        const char* begin = nullptr;        // байты файла в его кодировке
+        size_t size = 0;
+        bool fileStart = false;             // первый блок не UTF-8: BOM UTF-8 после перекодировки
+        bool ready = false;                 // обработан рабочим потоком
+        std::string text;                   // готовые строки CSV
+        std::vector<std::string> unknown;   // в порядке строк
+        FileDeps deps;
+        FileStats st;                       // счётчики и время этапов блока
+        BomSummary summary;
+        PlacementColumns columns;
+        std::exception_ptr error;
+    };
+    const size_t slots = 2 * (size_t)threads + 2;
+    std::vector<Block> ring(slots);         // блок k лежит в ring[k % slots]
+
+    std::mutex m;
+    std::condition_variable workCv, readyCv;
+    std::deque<size_t> work;
+    bool stop = false;
+
+    const ConversionRules& rules = gRules;
+    auto runBlock = [&](Block& b) {
+        StageClock bclk(stats ? &b.st : nullptr);
+        CsvReader r;
+        r.resetEncoded(b.begin, b.size, enc, /*bom=*/0, b.fileStart); // BOM файла пропущен при нарезке
+        std::vector<std::string> cells;
+        std::string stdName;
+        convertRows(r, dbMap, rules, b.text, b.unknown, b.st, bclk, cells, stdName,
+                    deps ? &b.deps : nullptr, summary ? &b.summary : nullptr, columns ? &b.columns : nullptr);
+    };
+
+    auto worker = [&] {
+        while (true) {
+            size_t k;
+            {
+                std::unique_lock<std::mutex> lk(m);
+                workCv.wait(lk, [&] { return stop || !work.empty(); });
+                if (work.empty()) return;
+                k = work.front(); work.pop_front();
+            }
+            Block& b = ring[k % slots];
+            try { runBlock(b); } catch (...) { b.error = std::current_exception(); }
+            { std::lock_guard<std::mutex> lk(m); b.ready = true; }
+            readyCv.notify_all();
+        }
+    };
+    std::vector<std::thread> pool;
+    pool.reserve(threads);
+    for (unsigned t = 0; t < threads; ++t) pool.emplace_back(worker);
+
+    std::exception_ptr error;
+    size_t produced = 0, emitted = 0;
+    bool eof = false;
+    try {
+        while (true) {
+            // нарезать блоки, пока есть свободные ячейки кольца
+            for (; !eof && produced - emitted < slots; ++produced) {
+                if (pos == end) { eof = true; break; }
+                const char* begin = pos;
+                for (size_t rows = 0; rows < kPipelineBlockRows && pos < end; ++rows) {
+                    const char* e = rawRecordEnd(pos, end, enc, ';');
+                    pos = e ? e : end;              // последняя запись — без '\n'
+                }
+                Block& b = ring[produced % slots];
+                std::lock_guard<std::mutex> lk(m);
+                b = Block{};
+                b.begin = begin;
+                b.size = (size_t)(pos - begin);
+                b.fileStart = produced == 0 && enc != TextEncoding::Utf8;
+                work.push_back(produced);
+                workCv.notify_one();
+            }
+            clk.lap(Stage::Read);
+            if (emitted == produced) break;
+
+            // следующий по порядку блок → в файл
+            Block& b = ring[emitted % slots];
+            {
+                std::unique_lock<std::mutex> lk(m);
+                readyCv.wait(lk, [&] { return b.ready; });
+            }
+            clk.skip();
+            if (b.error) { error = b.error; break; }
+            for (const auto& e : b.unknown) onUnknown(e);
+            if (deps)
+                for (const auto& u : b.deps.components) deps->add(u.name, tolower_copy(u.name), u.count);
+            st.rows += b.st.rows; st.written += b.st.written; st.dropped += b.st.dropped;
+            st.replaced += b.st.replaced; st.unknown += b.st.unknown;
+            for (unsigned s = 0; s < (unsigned)Stage::Count; ++s) st.ns[s] += b.st.ns[s];
+            if (summary) summary->merge(b.summary);
+            if (columns) { columns->add(b.columns); b.columns = PlacementColumns(); }
+            out.writeRaw(b.text);
+            b.text = std::string();             // отдать память блока сразу
+            ++emitted;
+            clk.lap(Stage::Write);
+        }
+    } catch (...) {
+        error = std::current_exception();
+    }
+
+    { std::lock_guard<std::mutex> lk(m); stop = true; }
+    workCv.notify_all();
+    for (auto& t : pool) t.join();
+    if (error) std::rethrow_exception(error); // временный файл удалит деструктор CsvWriter
+
+    st.bytesOut = out.bytes();
+    const bool committed = out.commit();
+    clk.lap(Stage::Write);
+    clk.finish();
+    if (!committed) { std::cerr << "Ошибка записи " << pathOut << "\n"; return st.rc = 1; }
+    return st.rc = 0;
+}
+
+
+// -------- Встраиваемый движок (ConversionEngine) --------
+// Для программ, которые конвертируют много раз за процесс (например, сервис выгрузки):
+// правила и база загружаются один раз в load(), а буферы строк, ячеек, результата, читатель
+// и писатель файлов переиспользуются от вызова к вызову. Подключение — как в Bench.cpp:
+//     #define ALTIUM_CONVERTER_NO_MAIN
+//     #include "MasterFile.cpp"
+// Каталоги и файлы настроек не создаются (Initialisation не нужна), вопросов нет:
+// неизвестные компоненты последнего вызова — в unknown(). Состояние у движка своё:
+// правила (не gRules), папка базы и её журнал (не kComponentsDir) — несколько движков
+// с разными папками не мешают друг другу. Общий для процесса только кэш нормализации
+// (gNormalizeCache, записи помечены отпечатком правил). Объект не потокобезопасен:
+// для нескольких потоков — копии, они делят правила и базу (ComponentDbStore), а буферы
+// у каждой свои. reloadDb/addComponent в любой копии публикуют новую версию базы для всех;
+// каждый вызов конвертации работает с версией, актуальной на его начало.
+class ConversionEngine {
+public:
+    ConversionEngine() = default;
+    // те же правила и база, свои буферы
+    ConversionEngine(const ConversionEngine& o)
+        : rules_(o.rules_), componentsDir_(o.componentsDir_), snapshotFile_(o.snapshotFile_), store_(o.store_) {}
+
+    // правила из rulesFile (нет файла — встроенные) и база из componentsDir;
+    // snapshotFile — бинарный снимок базы для быстрой загрузки (пусто — разбирать CSV).
+    // Вызывать до создания копий.
+    bool load(const std::string& componentsDir = kComponentsDir, const std::string& rulesFile = kRulesFile,
+              const std::string& snapshotFile = "") {
+        auto rules = std::make_shared<ConversionRules>();
+        if (!readRules(rulesFile, *rules)) return false;
+        rules_ = std::move(rules);
+        componentsDir_ = componentsDir;
+        snapshotFile_ = snapshotFile;
+        return reloadDb();
+    }
+
+    // перечитать базу (например, после правки CSV в папке базы)
+    bool reloadDb() {
+        if (!rules_) { std::cerr << "ConversionEngine: правила не загружены (load)\n"; return false; }
+        if (!store_) store_ = std::make_shared<ComponentDbStore>();
+        store_->publish(std::make_shared<const ComponentDb>(loadComponentsDb(componentsDir_, snapshotFile_)));
+        return true;
+    }
+
+    // добавить или изменить запись: сразу в журнал своей базы на диске (под DbLock) и новой версией в памяти
+    bool addComponent(const std::string& name, const CompInfo& info, const std::string& dbFile) {
+        if (!store_) { std::cerr << "ConversionEngine: база не загружена (load)\n"; return false; }
+        DbJournal journal;
+        journal.add(JournalEntry{ name, info, dbFile });
+        if (!journal.flush(componentsDir_)) return false;
+        store_->update([&](ComponentDb& db) { db.set(name, info); });
+        return true;
+    }
+
+    bool loaded() const { return store_ != nullptr; }
+    std::shared_ptr<const ComponentDb> db() const { return store_ ? store_->current() : nullptr; }
+    const ConversionRules& rules() const { return rules_ ? *rules_ : gRules; }
+    const std::string& componentsDir() const { return componentsDir_; }
+
+    // CSV в памяти → CSV в output (перезаписывается, ёмкость сохраняется);
+    // CP1251/UTF-16 на входе перекодируется окном читателя, как у файлов
+    int convert(std::string_view input, std::string& output, FileStats* stats = nullptr) {
+        output.clear();
+        unknown_.clear();
+        if (!store_) { std::cerr << "ConversionEngine: база не загружена (load)\n"; return 1; }
+        const auto db = store_->current();
+        FileStats local;
+        FileStats& st = stats ? *stats : local;
+        st = FileStats{};
+        st.bytesIn = input.size();
+        StageClock clk(stats);
+        size_t bom = 0;
+        const TextEncoding enc = detectEncoding(input.data(), input.size(), bom);
+        st.encoding = encodingName(enc);
+        reader_.resetEncoded(input.data(), input.size(), enc, bom);
+        convertRows(reader_, *db, *rules_, output, unknown_, st, clk, cells_, stdName_);
+        st.bytesOut = output.size();
+        clk.finish();
+        return st.rc = 0;
+    }
+
+    // поток → поток (вход читается целиком во внутренний буфер)
+    int convert(std::istream& in, std::ostream& out, FileStats* stats = nullptr) {
+        input_.clear();
+        char chunk[1 << 16];
+        while (in.read(chunk, sizeof chunk) || in.gcount() > 0) input_.append(chunk, (size_t)in.gcount());
+        if (in.bad()) { std::cerr << "ConversionEngine: ошибка чтения входного потока\n"; return 1; }
+        if (convert(input_, output_, stats) != 0) return 1;
+        out.write(output_.data(), (std::streamsize)output_.size());
+        if (!out) { std::cerr << "ConversionEngine: ошибка записи выходного потока\n"; return 1; }
+        return 0;
+    }
+
+    // файл → файл, как processFile (CSV или XLSX, запись через временный файл), но на своих
+    // правилах и буферах: результат копится в output_ и сбрасывается в файл блоками
+    int convertFile(const std::string& pathIn, const std::string& pathOut, FileStats* stats = nullptr) {
+        unknown_.clear();
+        if (!store_) { std::cerr << "ConversionEngine: база не загружена (load)\n"; return 1; }
+        const auto db = store_->current();
+        FileStats local;
+        FileStats& st = stats ? *stats : local;
+        st = FileStats{};
+        st.file = pathIn;
+        StageClock clk(stats);
+
+        if (!file_.open(pathIn)) { std::cerr << "Не удалось открыть " << pathIn << "\n"; return st.rc = 1; }
+        st.bytesIn = file_.bytes();
+        st.encoding = encodingName(file_.encoding());
+        if (!writer_.open(pathOut, gAtomicWrites)) { std::cerr << "Не удалось создать " << pathOut << "\n"; return st.rc = 1; }
+        output_.clear();
+        while (convertRows(file_, *db, *rules_, output_, unknown_, st, clk, cells_, stdName_,
+                           nullptr, nullptr, nullptr, kEngineFlushBytes)) {
+            writer_.writeRaw(output_);
+            output_.clear();
+        }
+        writer_.writeRaw(output_);
+        output_.clear();
+        if (file_.failed()) { writer_.abandon(); return st.rc = 1; }
+        st.bytesOut = writer_.bytes();
+        const bool committed = writer_.commit();
+        clk.lap(Stage::Write);
+        clk.finish();
+        if (!committed) { std::cerr << "Ошибка записи " << pathOut << "\n"; return st.rc = 1; }
+        return st.rc = 0;
+    }
+
+    // неизвестные компоненты последнего вызова, в порядке строк (с повторами)
+    const std::vector<std::string>& unknown() const { return unknown_; }
+
+private:
+    static constexpr size_t kEngineFlushBytes = 1 << 20;
+
+    std::shared_ptr<const ConversionRules> rules_;
+    std::string componentsDir_ = kComponentsDir, snapshotFile_;
+    std::shared_ptr<ComponentDbStore> store_;
+    CsvReader reader_;
+    RowReader file_;
+    CsvWriter writer_;
+    std::vector<std::string> cells_, unknown_;
+    std::string stdName_, input_, output_;
+};
+
+
+// -------- Манифест конвертации (Settings/Conversion.manifest) --------
+// Для каждого входного файла: размер, mtime и хэш содержимого, файл результата (путь,
+// размер, mtime), отпечаток правил и отпечаток тех записей базы, которые файл искал
+// (включая ненайденные). Файл пропускается, только если всё это совпадает, — правка
+// одной записи базы пересобирает лишь файлы, где этот компонент встречается.
+// Неизвестные компоненты пропущенного файла снова попадают в очередь из манифеста.
+// Формат — CSV: строка "F" на файл, за ней строки "K" (компонент; число строк).
+static const std::string kManifestFile    = kSettingsDir + "/Conversion.manifest";
+static constexpr unsigned kManifestVersion = 1; // менять вместе с логикой конвертации
+
+struct ManifestEntry {
+    std::string input, output;
+    uint64_t inSize = 0, outSize = 0, inHash = 0, rulesHash = 0, depsHash = 0;
+    int64_t  inMtime = 0, outMtime = 0;
+    FileDeps deps;
+};
+
+static int64_t fileMtime(const std::string& path) {
+    std::error_code ec;
+    auto t = fs::last_write_time(path, ec);
+    return ec ? 0 : (int64_t)t.time_since_epoch().count();
+}
+
+static uint64_t hashFileContent(const std::string& path, bool& ok) {
+    MappedFile f;
+    ok = f.open(path);
+    return ok ? fnv1a(f.data(), f.size()) : 0;
+}
+
+// отпечаток нужных файлу записей базы: ключи по порядку, для каждого — есть ли в базе,
+// флаг удаления и стандартное имя
+static uint64_t hashDeps(const FileDeps& deps, const ComponentDb& dbMap) {
+    std::vector<const std::string*> keys;
+    keys.reserve(deps.byKey.size());
+    for (const auto& kv : deps.byKey) keys.push_back(&kv.first);
+    std::sort(keys.begin(), keys.end(), [](const std::string* a, const std::string* b) { return *a < *b; });
+
+    uint64_t h = kFnvOffset;
+    for (const std::string* k : keys) {
+        h = fnv1a(*k, h);
+        const ComponentDb::Ref* ref = dbMap.find(*k);
+        const char state = !ref ? 'n' : ref->to_delete ? 'd' : 's';
+        h = fnv1a(&state, 1, h);
+        if (ref) h = fnv1a(ref->standard, h);
+        h = fnv1a("\0", 1, h);
+    }
+    return h;
+}
+
+static std::string manifestKey(const std::string& path) {
+    std::error_code ec;
+    fs::path p = fs::absolute(path, ec);
+    return (ec ? fs::path(path) : p.lexically_normal()).string();
+}
+
+class ConversionManifest {
+public:
+    bool load(const std::string& path) {
+        entries_.clear();
+        CsvReader in;
+        if (!in.open(path) || !in.next()) return false;
+        const auto& head = in.cells();
+        if (head.size() < 2 || head[0] != "altium-converter-manifest" ||
+            std::strtoul(std::string(head[1]).c_str(), nullptr, 10) != kManifestVersion) return false;
+
+        auto u64 = [](std::string_view v) { return (uint64_t)std::strtoull(std::string(v).c_str(), nullptr, 16); };
+        ManifestEntry* cur = nullptr;
+        while (in.next()) {
+            const auto& c = in.cells();
+            if (c.size() >= 10 && c[0] == "F") {
+                ManifestEntry e;
+                e.input  = std::string(c[1]);  e.inSize  = u64(c[2]); e.inMtime  = (int64_t)u64(c[3]); e.inHash = u64(c[4]);
+                e.output = std::string(c[5]);  e.outSize = u64(c[6]); e.outMtime = (int64_t)u64(c[7]);
+                e.rulesHash = u64(c[8]); e.depsHash = u64(c[9]);
+                cur = &(entries_[e.input] = std::move(e));
+            } else if (c.size() >= 3 && c[0] == "K" && cur) {
+                const std::string name(c[1]);
+                cur->deps.add(name, tolower_copy(name), u64(c[2]));
+            }
+        }
+        return true;
+    }
+
+    bool save(const std::string& path) const {
+        std::error_code ec;
+        fs::create_directories(fs::path(path).parent_path(), ec);
+        CsvWriter out(Quoting::Full);
+        if (!out.open(path, /*atomic=*/true)) return false;
+        auto hex = [](uint64_t v) { char b[20]; std::snprintf(b, sizeof b, "%llx", (unsigned long long)v); return std::string(b); };
+        out.writeRow(std::vector<std::string>{ "altium-converter-manifest", std::to_string(kManifestVersion) });
+
+        std::vector<const ManifestEntry*> sorted;
+        for (const auto& kv : entries_) sorted.push_back(&kv.second);
+        std::sort(sorted.begin(), sorted.end(), [](auto a, auto b) { return a->input < b->input; });
+        for (const ManifestEntry* e : sorted) {
+            out.writeRow(std::vector<std::string>{ "F", e->input, hex(e->inSize), hex((uint64_t)e->inMtime), hex(e->inHash),
+                                                   e->output, hex(e->outSize), hex((uint64_t)e->outMtime),
+                                                   hex(e->rulesHash), hex(e->depsHash) });
+            for (const auto& u : e->deps.components)
+                out.writeRow(std::vector<std::string>{ "K", u.name, hex(u.count) });
+        }
+        return out.commit();
+    }
+
+    // запись файла, если его можно не конвертировать; только читает — безопасно из потоков
+    const ManifestEntry* upToDate(const std::string& input, const std::string& output,
+                                  const ComponentDb& dbMap) const {
+        auto it = entries_.find(manifestKey(input));
+        if (it == entries_.end()) return nullptr;
+        const ManifestEntry& e = it->second;
+        std::error_code ec;
+        if (e.output != manifestKey(output) || e.rulesHash != gRules.fingerprint) return nullptr;
+        if (fs::file_size(output, ec) != e.outSize || ec || fileMtime(output) != e.outMtime) return nullptr;
+        if (fs::file_size(input, ec) != e.inSize || ec) return nullptr;
+        if (fileMtime(input) != e.inMtime) { // тронут, но, может быть, не изменён
+            bool ok = false;
+            if (hashFileContent(input, ok) != e.inHash || !ok) return nullptr;
+        }
+        return hashDeps(e.deps, dbMap) == e.depsHash ? &e : nullptr;
+    }
+
+    // описание только что сконвертированного файла (вызывать после записи результата)
+    static std::optional<ManifestEntry> describe(const std::string& input, const std::string& output, FileDeps deps,
+                                                 const ComponentDb& dbMap) {
+        ManifestEntry e;
+        std::error_code ec;
+        bool ok = false;
+        e.input    = manifestKey(input);
+        e.output   = manifestKey(output);
+        e.inSize   = fs::file_size(input, ec);   if (ec) return std::nullopt;
+        e.inMtime  = fileMtime(input);
+        e.inHash   = hashFileContent(input, ok); if (!ok) return std::nullopt;
+        e.outSize  = fs::file_size(output, ec);  if (ec) return std::nullopt;
+        e.outMtime = fileMtime(output);
+        e.rulesHash = gRules.fingerprint;
+        e.depsHash  = hashDeps(deps, dbMap);
+        e.deps      = std::move(deps);
+        return e;
+    }
+
+    void put(ManifestEntry e) { std::string k = e.input; entries_[k] = std::move(e); }
+    void forget(const std::string& input) { entries_.erase(manifestKey(input)); }
+
+    // убрать записи о входных файлах, которых больше нет
+    void pruneMissing() {
+        std::error_code ec;
+        for (auto it = entries_.begin(); it != entries_.end(); )
+            it = fs::exists(it->first, ec) ? std::next(it) : entries_.erase(it);
+    }
+
+private:
+    std::unordered_map<std::string, ManifestEntry> entries_; // manifestKey(input) → запись
+};
+
+// -------- Пул потоков для пакетной конвертации --------
+static unsigned gJobs = 0; // -j: число потоков, 0 = по числу ядер
+
+static unsigned jobCount(size_t tasks) {
+    unsigned n = gJobs ? gJobs : std::thread::hardware_concurrency();
+    if (n == 0) n = 1;
+    return (unsigned)std::min<size_t>(n, std::max<size_t>(tasks, 1));
+}
+
+// task(i) для i в [0, count): у каждого потока своя очередь индексов, освободившийся поток
+// забирает задачи с хвоста чужих очередей (work stealing). Новые задачи не появляются,
+// поэтому «все очереди пусты» = работа закончена.
+static void parallelFor(size_t count, unsigned threads, const std::function<void(size_t)>& task) {
+    if (threads <= 1) { for (size_t i = 0; i < count; ++i) task(i); return; }
+
+    struct WorkQueue { std::mutex m; std::deque<size_t> q; };
+    std::vector<WorkQueue> queues(threads);
+    for (size_t i = 0; i < count; ++i) queues[i % threads].q.push_back(i);
+
+    auto worker = [&](unsigned self) {
+        while (true) {
+            std::optional<size_t> job;
+            {
+                WorkQueue& own = queues[self];
+                std::lock_guard<std::mutex> lk(own.m);
+                if (!own.q.empty()) { job = own.q.front(); own.q.pop_front(); }
+            }
+            for (unsigned k = 1; !job && k < threads; ++k) {
+                WorkQueue& victim = queues[(self + k) % threads];
+                std::lock_guard<std::mutex> lk(victim.m);
+                if (!victim.q.empty()) { job = victim.q.back(); victim.q.pop_back(); }
             }
+            if (!job) return;
+            task(*job);
         }
+    };
 
-if (drop_line) {
-    if (verbose) std::cout << "↑ строка удалена по правилу базы\n";
-    std::cout << "-------------------\n";
-    continue; // НЕ записывать строку
+    std::vector<std::thread> pool;
+    pool.reserve(threads - 1);
+    for (unsigned t = 1; t < threads; ++t) pool.emplace_back(worker, t);
+    worker(0);
+    for (auto& t : pool) t.join();
+}
+
+// .cols записан после результата (а не остался от старой конвертации)
+static bool columnarFresh(const std::string& outPath) {
+    const std::string cols = columnarPath(outPath);
+    std::error_code ec;
+    return fs::is_regular_file(cols, ec) && fileMtime(cols) >= fileMtime(outPath);
 }
 
-        // запись строки в выходной CSV с ';'
-        for (size_t i = 0; i < cells.size(); ++i) {
-            cells[i] = fixCyrillicLetters(normalizeCell(cells[i]));
-            out << cells[i];
-            if (i + 1 < cells.size()) out << ';';
+// Конвертировать пачку файлов параллельно. Неизвестные компоненты не спрашиваются,
+// а собираются в pending. Прогресс печатается строго в порядке files, очередь
+// сливается в том же порядке — вывод не зависит от числа потоков.
+// stats (необязательно) — по FileStats на каждый файл, в порядке files.
+// manifest (необязательно) — не трогать файлы без изменений и обновить записи о прочих.
+// summaries (необязательно) — по BomSummary на каждый файл, в порядке files; для пропущенных
+// по манифесту сводка считается по уже готовому результату.
+// columnar — рядом с каждым результатом записать board.cols; файл без свежего .cols
+// конвертируется заново, даже если манифест считает его неизменным.
+// [[maybe_unused]] — без main (ALTIUM_CONVERTER_NO_MAIN) его вызывает только Bench.cpp.
+[[maybe_unused]] static size_t convertBatch(const std::vector<std::string>& files, const std::string& outDir,
+                           const ComponentDb& dbMap, PendingQueue& pending,
+                           std::vector<FileStats>* stats = nullptr, ConversionManifest* manifest = nullptr,
+                           size_t* skippedOut = nullptr, std::vector<BomSummary>* summaries = nullptr,
+                           bool columnar = false) {
+    const size_t n = files.size();
+    if (stats) stats->assign(n, FileStats{});
+    if (summaries) summaries->assign(n, BomSummary{});
+    std::vector<int>          rc(n, 1);
+    std::vector<PendingQueue> perFile(n);
+    std::vector<std::string>  outNames(n);
+    std::vector<std::optional<ManifestEntry>> fresh(n);
+    std::vector<bool>         skipped(n, false);
+    for (size_t i = 0; i < n; ++i)
+        outNames[i] = outputPath(outDir, files[i]);
+
+    std::mutex progressMutex;
+    std::vector<bool> done(n, false);
+    size_t nextToPrint = 0;
+
+    // файлов меньше, чем потоков, — лишние потоки отдаются конвейеру внутри больших файлов
+    const unsigned fileThreads = jobCount(n);
+    const unsigned rowThreads  = jobCount(SIZE_MAX) / fileThreads;
+
+    parallelFor(n, fileThreads, [&](size_t i) {
+        PendingQueue& q = perFile[i];
+        UnknownHandler defer = [&](const std::string& elem) -> std::optional<CompInfo> {
+            q.add(elem, files[i]);
+            return std::nullopt;
+        };
+        BomSummary* sum = summaries ? &(*summaries)[i] : nullptr;
+        if (sum) sum->file = files[i];
+        try {
+            const ManifestEntry* same = manifest ? manifest->upToDate(files[i], outNames[i], dbMap) : nullptr;
+            if (same && columnar && !columnarFresh(outNames[i])) same = nullptr;
+            if (same) {
+                skipped[i] = true;
+                rc[i] = 0;
+                for (const auto& u : same->deps.components)          // неизвестные — снова в очередь
+                    if (!dbMap.contains(u.name)) q.add(u.name, files[i], u.count);
+                if (stats) { (*stats)[i].file = files[i]; (*stats)[i].rc = 0; }
+                if (sum && !summarizeConverted(outNames[i], *sum)) {
+                    std::cerr << "Не удалось открыть " << outNames[i] << "\n";
+                    rc[i] = 1;
+                }
+            } else {
+                FileDeps deps;
+                ColumnarWriter cols(columnarPath(outNames[i]));
+                std::error_code ec;
+                const auto size = fs::file_size(files[i], ec);
+                if (rowThreads > 1 && !ec && size >= kPipelineMinBytes && !isXlsx(files[i]) && !isXls(files[i]))
+                    rc[i] = processFilePipelined(files[i], outNames[i], dbMap,
+                                                 [&](const std::string& elem) { q.add(elem, files[i]); }, rowThreads,
+                                                 stats ? &(*stats)[i] : nullptr, manifest ? &deps : nullptr, sum,
+                                                 columnar ? &cols : nullptr);
+                else
+                    rc[i] = processFile(files[i], outNames[i], /*verbose=*/false, dbMap, defer,
+                                        stats ? &(*stats)[i] : nullptr, manifest ? &deps : nullptr, sum,
+                                        columnar ? &cols : nullptr);
+                if (columnar && rc[i] == 0 && !cols.commit()) rc[i] = 1;
+                if (manifest && rc[i] == 0) fresh[i] = ConversionManifest::describe(files[i], outNames[i], std::move(deps), dbMap);
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "Ошибка при конвертации " << files[i] << ": " << e.what() << "\n";
+            rc[i] = 1;
+            if (stats) (*stats)[i].rc = 1;
+        }
+
+        std::lock_guard<std::mutex> lk(progressMutex);
+        done[i] = true;
+        for (; nextToPrint < n && done[nextToPrint]; ++nextToPrint) {
+            const size_t k = nextToPrint;
+            std::cout << "- " << fs::path(files[k]).filename().string() << " → " << outNames[k]
+                      << (rc[k] != 0 ? "  [ошибка]" : skipped[k] ? "  [без изменений]" : "") << "\n";
         }
-        out << "\n";
+    });
+
+    size_t ok = 0, nSkipped = 0;
+    for (size_t i = 0; i < n; ++i) {
+        if (rc[i] == 0) ++ok;
+        if (skipped[i]) ++nSkipped;
+        pending.merge(perFile[i]);
+        if (summaries) (*summaries)[i].ok = rc[i] == 0;
+        if (!manifest || skipped[i]) continue;
+        if (fresh[i]) manifest->put(std::move(*fresh[i]));
+        else          manifest->forget(files[i]);
     }
-    return 0;
+    if (skippedOut) *skippedOut = nSkipped;
+    return ok;
 }
 
+// ALTIUM_CONVERTER_NO_MAIN — подключить файл без main (Bench.cpp, ConversionEngine):
+// меню, сверка с документацией, поиск по базе, пакетный режим и main тогда не собираются
+// (как и помощники выше, помеченные "только для меню и пакетного режима")
+#ifndef ALTIUM_CONVERTER_NO_MAIN
 
+// Разобрать очередь: заполненные вручную строки вносятся сразу, остальные (в интерактивном
+// режиме) — через обычный диалог добавления. Возвращает нерешённое; в touchedFiles —
+// имена входных файлов, где встречались решённые компоненты.
+static PendingQueue resolvePending(PendingQueue& q, ComponentDbStore& store,
+                                   bool interactive, std::vector<std::string>* touchedFiles = nullptr) {
+    PendingQueue left;
+    const auto db = store.current();                  // имена в очереди не повторяются
+    std::vector<std::pair<std::string, CompInfo>> edits; // заполненные вручную — одной версией базы
+    for (auto& p : q.items) {
+        bool resolved = db->contains(p.name) != 0; // уже в базе
+        if (!resolved) {
+            const bool edited = !p.standard.empty() || p.del == "1";
+            if (edited) {
+                // файл базы из очереди — как из меню: CSV в Components (новый — только явным "имя.csv")
+                std::string dbPath;
+                if (!p.dbFile.empty() && !isComponentDbFileName(p.dbFile)) {
+                    std::cerr << "\"" << p.name << "\": файл базы \"" << p.dbFile << "\" — нужно имя.csv в папке "
+                              << kComponentsDir << ", строка оставлена в очереди\n";
+                } else if (!p.dbFile.empty()) {
+                    dbPath = (fs::path(kComponentsDir) / p.dbFile).string();
+                    std::error_code ec;
+                    if (!fs::exists(dbPath, ec)) std::cout << "Новый файл базы: " << p.dbFile << "\n";
+                } else if (interactive) {
+                    dbPath = pickComponentsFile(p.name);
+                }
+                CompInfo info{ p.standard.empty() ? p.name : p.standard, p.del == "1" };
+                resolved = !dbPath.empty();
+                if (resolved) { journalComponent(dbPath, p.name, info); edits.emplace_back(p.name, std::move(info)); }
+            } else if (interactive) {
+                std::cout << "\n[" << p.occurrences << " шт.] ";
+                for (size_t i = 0; i < p.files.size(); ++i) std::cout << (i ? ", " : "") << p.files[i];
+                std::cout << "\n";
+                resolved = maybeAddComponentToDb(p.name, store).has_value();
+            }
+        }
+        if (!resolved) { left.get(p.name) = std::move(p); continue; }
+        if (touchedFiles)
+            for (const auto& f : p.files)
+                if (std::find(touchedFiles->begin(), touchedFiles->end(), f) == touchedFiles->end())
+                    touchedFiles->push_back(f);
+    }
+    if (!edits.empty())
+        store.update([&](ComponentDb& next) { for (const auto& [name, info] : edits) next.set(name, info); });
+    return left;
+}
 
 // -------- Конвертация --------
-static int convertOne(const std::string& path) {
+static int convertOne(const std::string& path, ComponentDbStore& store) {
     std::cout << "\n Конвертация: " << path << "\n";
-    const std::string outName = (fs::path("Converted") / fs::path(path).filename()).string();
-    int rc = processFile(path, outName, /*verbose=*/true);
+    const std::string outName = outputPath("Converted", path);
+    const auto db = store.current();                  // версия на начало файла
+    UnknownHandler ask = [&](const std::string& elem) -> std::optional<CompInfo> {
+        const auto latest = store.current();          // уже добавлен выше в этом же файле
+        if (const ComponentDb::Ref* r = latest->find(elem)) return CompInfo{ std::string(r->standard), r->to_delete };
+        return maybeAddComponentToDb(elem, store);
+    };
+    int rc = processFile(path, outName, /*verbose=*/true, *db, ask);
+    finishDbSession();
     if (rc == 0) std::cout << "Готово → " << outName << "\n";
     std::cout << "Нажмите Enter для возврата в меню...";
     std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
     return rc;
 }
 
-static void convertAll(const std::vector<std::string>& files){
+// Все файлы — параллельно; вопросы про новые компоненты задаются один раз после
+// прохода, затем файлы с решёнными компонентами конвертируются заново.
+static void convertAll(const std::vector<std::string>& files, ComponentDbStore& store){
     if (files.empty()) {
         std::cout << "\n Нет файлов.\n Нажмите Enter...";
         std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
         return;
     }
-    std::cout << "\n Всего файлов: " << files.size() << "\n";
-    size_t ok = 0;
-    for (const auto& f : files) {
-        const std::string outName = (fs::path("Converted") / fs::path(f).filename()).string();
-        std::cout << "- " << fs::path(f).filename().string() << " → " << outName << "\n";
-        int rc = processFile(f, outName, /*verbose=*/false);
-        if (rc == 0) ++ok;
+    std::cout << "\n Всего файлов: " << files.size() << " (потоков: " << jobCount(files.size()) << ")\n";
+    ConversionManifest manifest;
+    manifest.load(kManifestFile);
+    PendingQueue pending;
+    size_t skipped = 0;
+    size_t ok = convertBatch(files, "Converted", *store.current(), pending, nullptr, &manifest, &skipped);
+
+    if (!pending.items.empty()) {
+        std::cout << "\n Новых компонентов: " << pending.items.size() << "\n";
+        std::vector<std::string> touched;
+        resolvePending(pending, store, /*interactive=*/true, &touched);
+
+        std::vector<std::string> redo;
+        for (const auto& f : files)
+            if (std::find(touched.begin(), touched.end(), fs::path(f).filename().string()) != touched.end())
+                redo.push_back(f);
+        if (!redo.empty()) {
+            std::cout << "\n Повторная конвертация: " << redo.size() << "\n";
+            PendingQueue rest;
+            convertBatch(redo, "Converted", *store.current(), rest, nullptr, &manifest);
+        }
     }
-    std::cout << "Готово: " << ok << "/" << files.size() << " успешно.\n"
+    finishDbSession();
+    manifest.pruneMissing();
+    manifest.save(kManifestFile);
+    std::cout << "Готово: " << ok << "/" << files.size() << " успешно (без изменений: " << skipped << ").\n"
               << "Нажмите Enter для возврата в меню...";
     std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
 }
 
 // -------- Меню конвертации --------
 static int selectAndConvert() {
+    ComponentDbStore store(loadComponentsDb()); // база — одна на сеанс, новые компоненты — новыми версиями
     while (true) {
         auto files = listFiles(kFolder);
 
@@ -581,27 +4958,1064 @@ static int selectAndConvert() {
         if (idx == -2) continue; // F5
 
         if (idx == (int)items.size() - 1) { std::cout << "Exit.\n"; return 0; }
-        if (idx == (int)items.size() - 2) { convertAll(files); continue; }
+        if (idx == (int)items.size() - 2) { convertAll(files, store); continue; }
 
         if (idx >= 0 && idx < (int)files.size()) {
-            convertOne(files[idx]);
+            convertOne(files[idx], store);
+        }
+    }
+}
+
+// -------- Сверка с документацией (BOM / перечень элементов) --------
+// Документация читается в хэш-таблицу по позиционному обозначению, сконвертированный файл
+// проходит потоком: каждая его строка ищется в таблице и сравнивается по компоненту, корпусу
+// и повороту. Компонент из документации приводится к виду результата конвертации
+// (нормализация + замена по базе), поэтому сравниваются уже стандартные имена. Строки
+// документации, которые база велит удалять, в результат не попадают и пропуском не считаются.
+enum class BomDiffKind { Missing, Extra, Value, Footprint, Rotation, Duplicate, Count };
+static const char* const kBomDiffNames[]  = { "missing", "extra", "value", "footprint", "rotation", "duplicate" };
+static const char* const kBomDiffTitles[] = { "нет в результате", "нет в документации", "другой компонент",
+                                              "другой корпус", "другой поворот", "повтор обозначения" };
+
+struct BomDiff {
+    BomDiffKind kind;
+    std::string designator;
+    std::string converted, documented; // значение каждой стороны (пусто — строки нет)
+};
+
+struct BomDiffReport {
+    size_t convertedRows = 0, docRows = 0, docDesignators = 0, matched = 0, ignored = 0;
+    size_t counts[(unsigned)BomDiffKind::Count] = {};
+    std::vector<BomDiff> diffs;
+
+    void add(BomDiffKind k, const std::string& des, std::string conv, std::string doc) {
+        ++counts[(unsigned)k];
+        diffs.push_back({ k, des, std::move(conv), std::move(doc) });
+    }
+};
+
+// столбцы документации; без узнаваемого заголовка — та же раскладка, что у pick-and-place
+struct BomLayout {
+    char   delim = ';';
+    bool   header = false;
+    size_t designator = 0, value = 0;
+    size_t footprint = std::string::npos, rotation = std::string::npos;
+};
+
+// начала заголовков (без учёта регистра латиницы) для каждого столбца
+static const std::vector<std::string> kBomDesignatorNames = { "designator", "refdes", "ref des", "reference", "поз", "Поз" };
+static const std::vector<std::string> kBomFootprintNames  = { "footprint", "package", "корпус", "Корпус" };
+static const std::vector<std::string> kBomRotationNames   = { "rotation", "angle", "поворот", "Поворот", "угол", "Угол" };
+static const std::vector<std::string> kBomValueNames      = { "comment", "value", "component", "part", "наименование",
+                                                              "Наименование", "номинал", "Номинал" };
+
+static BomLayout detectBomLayout(const TextFile& file) {
+    BomLayout l;
+    l.value = gRules.componentColumn;
+    l.designator = gRules.designatorColumn;
+    l.rotation = gRules.rotationColumn;
+
+    // разделитель — самый частый из ';' ',' '\t' в первой строке
+    const std::string head = file.head(kEncodingSample);
+    std::string_view first = std::string_view(head).substr(0, head.find('\n'));
+    size_t best = 0;
+    for (char d : { ';', ',', '\t' }) {
+        const size_t n = (size_t)std::count(first.begin(), first.end(), d);
+        if (n > best) { best = n; l.delim = d; }
+    }
+
+    CsvReader r(l.delim);
+    r.resetEncoded(file.data(), file.size(), file.encoding(), file.bom());
+    if (!r.next()) return l;
+    auto is = [](std::string_view cell, const std::vector<std::string>& names) {
+        const std::string h = tolower_copy(std::string(trim_view(cell)));
+        for (const auto& n : names)
+            if (h.compare(0, n.size(), n) == 0) return true;
+        return false;
+    };
+    size_t des = std::string::npos, val = std::string::npos, fp = std::string::npos, rot = std::string::npos;
+    const auto& cells = r.cells();
+    for (size_t i = 0; i < cells.size(); ++i) {
+        if      (is(cells[i], kBomDesignatorNames)) { if (des == std::string::npos) des = i; }
+        else if (is(cells[i], kBomFootprintNames))  { if (fp  == std::string::npos) fp  = i; }
+        else if (is(cells[i], kBomRotationNames))   { if (rot == std::string::npos) rot = i; }
+        else if (is(cells[i], kBomValueNames))      { if (val == std::string::npos) val = i; }
+    }
+    if (des == std::string::npos || val == std::string::npos) return l; // заголовка нет
+    l.header = true;
+    l.designator = des; l.value = val; l.footprint = fp; l.rotation = rot;
+    return l;
+}
+
+// "C1, C2 C5-C8 R3...R5" → по одному обозначению; диапазон — одинаковый префикс и номера по возрастанию
+static void expandDesignators(std::string_view cell, std::vector<std::string>& out) {
+    auto split = [](std::string_view t, std::string_view& prefix, unsigned long& num) {
+        size_t k = t.size();
+        while (k > 0 && std::isdigit((unsigned char)t[k - 1])) --k;
+        if (k == t.size() || t.size() - k > 9) return false;
+        prefix = t.substr(0, k);
+        num = std::strtoul(std::string(t.substr(k)).c_str(), nullptr, 10);
+        return true;
+    };
+    size_t b = 0;
+    while (b < cell.size()) {
+        while (b < cell.size() && (cell[b] == ',' || cell[b] == ' ' || cell[b] == '\t' || cell[b] == ';')) ++b;
+        size_t e = b;
+        while (e < cell.size() && cell[e] != ',' && cell[e] != ' ' && cell[e] != '\t' && cell[e] != ';') ++e;
+        const std::string_view tok = cell.substr(b, e - b);
+        b = e;
+        if (tok.empty()) continue;
+
+        size_t dash = std::string_view::npos, skip = 0;
+        for (std::string_view sep : { "...", "\xE2\x80\xA6", "-" })  // "...", "…", "-"
+            if (size_t p = tok.find(sep, 1); p != std::string_view::npos) { dash = p; skip = sep.size(); break; }
+        std::string_view p1, p2;
+        unsigned long n1 = 0, n2 = 0;
+        if (dash != std::string_view::npos && split(tok.substr(0, dash), p1, n1) &&
+            split(tok.substr(dash + skip), p2, n2) && (p2.empty() || p1 == p2) && n1 <= n2 && n2 - n1 < 10000) {
+            for (unsigned long n = n1; n <= n2; ++n) out.push_back(std::string(p1) + std::to_string(n));
+        } else {
+            out.emplace_back(tok);
+        }
+    }
+}
+
+// ключ обозначения без учёта регистра (из документации — уже после N(x), как в результате)
+static std::string designatorKey(std::string_view des) {
+    std::string k(trim_view(des));
+    for (char& c : k) c = (char)std::toupper((unsigned char)c);
+    return k;
+}
+
+// поворот: число по модулю 360 ("90.00" = "90" = "-270") + правило поворота для C*/R*
+static std::string canonicalRotation(std::string_view s, std::string_view designator) {
+    auto number = [](std::string_view v) {
+        std::string t(trim_view(v));
+        std::replace(t.begin(), t.end(), ',', '.');
+        char* end = nullptr;
+        const double d = std::strtod(t.c_str(), &end);
+        if (t.empty() || *end != '\0') return t;
+        double m = std::fmod(d, 360.0);
+        if (m < 0) m += 360.0;
+        if (m >= 359.9995) m = 0;
+        char b[32];
+        std::snprintf(b, sizeof b, "%g", std::round(m * 1000) / 1000);
+        return std::string(b);
+    };
+    std::string r = number(s);
+    const ConversionRules& rules = gRules;
+    if (!designator.empty() &&
+        rules.rotatePrefixes.find((char)std::toupper((unsigned char)designator[0])) != std::string::npos) {
+        for (const auto& [from, to] : rules.rotateMap)
+            if (r == number(from)) { r = number(to); break; }
+    }
+    return r;
+}
+
+// корпус из документации должен встречаться в имени компонента отдельным словом
+static bool footprintMatches(const std::string& component, std::string_view footprint) {
+    const std::string c = tolower_copy(component), f = tolower_copy(std::string(trim_view(footprint)));
+    if (f.empty()) return true;
+    auto word = [](char ch) { return std::isalnum((unsigned char)ch) != 0; };
+    for (size_t p = c.find(f); p != std::string::npos; p = c.find(f, p + 1))
+        if ((p == 0 || !word(c[p - 1])) && (p + f.size() == c.size() || !word(c[p + f.size()]))) return true;
+    return false;
+}
+
+static bool sameComponent(const std::string& a, const std::string& b) {
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(),
+                                              [](char x, char y) { return ComponentDb::fold(x) == ComponentDb::fold(y); });
+}
+
+static bool compareBom(const std::string& convertedPath, const std::string& docPath,
+                       const ComponentDb& dbMap, BomDiffReport& rep) {
+    struct DocRow { std::string designator, value, footprint, rotation; bool seen = false; };
+    const ConversionRules& rules = gRules;
+
+    TextFile doc;                                       // BOM из Excel часто в CP1251
+    if (!doc.open(docPath)) { std::cerr << "Не удалось открыть " << docPath << "\n"; return false; }
+    const BomLayout layout = detectBomLayout(doc);
+
+    // === документация → таблица обозначений ===
+    std::vector<DocRow> rows;
+    std::unordered_map<std::string, size_t> byDes;
+    std::vector<std::string> designators;
+    CsvReader in(layout.delim);
+    in.resetEncoded(doc.data(), doc.size(), doc.encoding(), doc.bom());
+    if (layout.header) in.next();
+    while (in.next()) {
+        const auto& cells = in.cells();
+        auto cell = [&](size_t i) { return i < cells.size() ? trim_view(cells[i]) : std::string_view(); };
+        designators.clear();
+        expandDesignators(cell(layout.designator), designators);
+        if (designators.empty()) continue;
+        ++rep.docRows;
+
+        // компонент — как при конвертации: ключ N(x), в файл идёт стандарт или N(N(x))
+        std::string key, value;
+        normalizeCellCached(std::string(cell(layout.value)), key);
+        if (rules.isPointColumn(rules.componentColumn)) normalizeCellCached(key, value);
+        else                                            value = key;
+        if (const ComponentDb::Ref* info = dbMap.find(trim_view(key))) {
+            if (info->to_delete) { rep.ignored += designators.size(); continue; }
+            if (!info->standard.empty()) normalizeCellCached(std::string(info->standard), value);
+        }
+        for (const auto& d : designators) {
+            DocRow row;
+            row.designator = normalizeCell(d);
+            row.value = value;
+            row.footprint = fixCyrillicLetters(std::string(cell(layout.footprint)));
+            if (layout.rotation != std::string::npos)
+                row.rotation = canonicalRotation(cell(layout.rotation), row.designator);
+            auto [it, inserted] = byDes.emplace(designatorKey(row.designator), rows.size());
+            if (!inserted) { rep.add(BomDiffKind::Duplicate, row.designator, "", row.value); continue; }
+            rows.push_back(std::move(row));
+        }
+    }
+    rep.docDesignators = rows.size();
+
+    // === результат конвертации — потоком ===
+    CsvReader conv;
+    if (!conv.open(convertedPath)) { std::cerr << "Не удалось открыть " << convertedPath << "\n"; return false; }
+    std::unordered_set<std::string> seen;
+    seen.reserve(rows.size());
+    while (conv.next()) {
+        const auto& cells = conv.cells();
+        auto cell = [&](size_t i) { return i < cells.size() ? trim_view(cells[i]) : std::string_view(); };
+        const std::string_view des = cell(rules.designatorColumn);
+        if (des.empty()) continue;
+        ++rep.convertedRows;
+        const std::string value(cell(rules.componentColumn));
+        std::string key = designatorKey(des);
+        if (!seen.insert(key).second) { rep.add(BomDiffKind::Duplicate, std::string(des), value, ""); continue; }
+
+        auto it = byDes.find(key);
+        if (it == byDes.end()) { rep.add(BomDiffKind::Extra, std::string(des), value, ""); continue; }
+        DocRow& d = rows[it->second];
+        d.seen = true;
+        bool same = true;
+        if (!sameComponent(value, d.value)) {
+            rep.add(BomDiffKind::Value, d.designator, value, d.value);
+            same = false;
+        } else if (!footprintMatches(value, d.footprint)) {
+            rep.add(BomDiffKind::Footprint, d.designator, value, d.footprint);
+            same = false;
         }
+        if (layout.rotation != std::string::npos) {
+            const std::string rot = canonicalRotation(cell(rules.rotationColumn), des);
+            if (rot != d.rotation) { rep.add(BomDiffKind::Rotation, d.designator, rot, d.rotation); same = false; }
+        }
+        if (same) ++rep.matched;
+    }
+    for (const auto& d : rows)
+        if (!d.seen) rep.add(BomDiffKind::Missing, d.designator, "", d.value);
+    return true;
+}
+
+static bool saveBomDiff(const std::string& path, const BomDiffReport& rep) {
+    CsvWriter out(Quoting::Minimal);
+    if (!out.open(path, gAtomicWrites)) { std::cerr << "Не удалось создать " << path << "\n"; return false; }
+    out.writeRow(std::vector<std::string>{ "Designator", "Difference", "Converted", "Documentation" });
+    for (const auto& d : rep.diffs)
+        out.writeRow(std::vector<std::string>{ d.designator, kBomDiffNames[(unsigned)d.kind], d.converted, d.documented });
+    if (!out.commit()) { std::cerr << "Ошибка записи " << path << "\n"; return false; }
+    return true;
+}
+
+static void printBomDiff(const BomDiffReport& rep, size_t limit) {
+    std::cout << "Строк: в результате " << rep.convertedRows << ", в документации " << rep.docRows
+              << " (обозначений " << rep.docDesignators << ", удаляемых по базе " << rep.ignored << ")\n"
+              << "Совпало: " << rep.matched << "\n";
+    for (unsigned k = 0; k < (unsigned)BomDiffKind::Count; ++k)
+        if (rep.counts[k]) std::cout << "  " << kBomDiffTitles[k] << ": " << rep.counts[k] << "\n";
+    for (size_t i = 0; i < rep.diffs.size() && i < limit; ++i) {
+        const BomDiff& d = rep.diffs[i];
+        std::cout << "  " << d.designator << "  [" << kBomDiffTitles[(unsigned)d.kind] << "]  "
+                  << (d.converted.empty() ? "-" : d.converted) << "  |  " << (d.documented.empty() ? "-" : d.documented) << "\n";
     }
+    if (rep.diffs.size() > limit) std::cout << "  ... ещё " << rep.diffs.size() - limit << "\n";
+}
+
+// отчёт по умолчанию — рядом с результатом: board.csv → board.diff.csv
+static std::string bomDiffPath(const std::string& convertedPath) {
+    return fs::path(convertedPath).replace_extension().string() + ".diff.csv";
+}
+
+// не результаты, а файлы рядом с ними в Converted/: *.diff.csv, *.summary.csv и *.cols
+static bool isReportFile(const fs::path& p) {
+    const std::string name = tolower_copy(p.filename().string());
+    auto endsWith = [&](const std::string& suffix) {
+        return name.size() > suffix.size() && name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0;
+    };
+    return endsWith(".diff.csv") || endsWith(".summary.csv") || endsWith(".cols");
+}
+
+// 0 — совпадает, 3 — есть расхождения, 1 — ошибка
+static int runCompare(const std::string& convertedPath, const std::string& docPath, std::string reportPath) {
+    if (reportPath.empty()) reportPath = bomDiffPath(convertedPath);
+    const ComponentDb dbMap = loadComponentsDb();
+    BomDiffReport rep;
+    if (!compareBom(convertedPath, docPath, dbMap, rep) || !saveBomDiff(reportPath, rep)) return 1;
+    printBomDiff(rep, 20);
+    std::cout << "Отчёт → " << reportPath << "\n";
+    return rep.diffs.empty() ? 0 : 3;
 }
 
-// -------- Заглушки других пунктов --------
 static void compareWithDocs() {
-    std::cout << "[Compare with documentation] недоступно в этой версии.\n";
-    std::cout << "Нажмите Enter..."; std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    auto pause = [] { std::cout << "Нажмите Enter..."; std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n'); };
+    std::vector<std::string> converted;
+    for (auto& p : listFiles("Converted"))
+        if (!isReportFile(p)) converted.push_back(std::move(p));
+    const auto docs = listFiles("Documents");
+    if (converted.empty() || docs.empty()) {
+        std::cout << "\n Нужны файлы в \"Converted\" и \"Documents\".\n";
+        pause();
+        return;
+    }
+
+    std::vector<std::string> items;
+    for (const auto& p : converted) items.push_back(fs::path(p).filename().string());
+    items.push_back("[Exit]");
+    int idx;
+    while ((idx = selectIndex(items, "=== Converted file to check ===")) == -2) {}
+    if (idx < 0 || idx >= (int)converted.size()) return;
+
+    // документ с тем же именем выбирается сам
+    std::string doc;
+    for (const auto& d : docs)
+        if (fs::path(d).stem() == fs::path(converted[idx]).stem()) doc = d;
+    if (doc.empty()) {
+        items.clear();
+        for (const auto& p : docs) items.push_back(fs::path(p).filename().string());
+        items.push_back("[Exit]");
+        int di;
+        while ((di = selectIndex(items, "=== Documentation for " + fs::path(converted[idx]).filename().string() + " ===")) == -2) {}
+        if (di < 0 || di >= (int)docs.size()) return;
+        doc = docs[di];
+    }
+
+    std::cout << "\n Сверка: " << converted[idx] << "  ↔  " << doc << "\n";
+    runCompare(converted[idx], doc, "");
+    pause();
+}
+
+// -------- База компонентов: поиск и массовые правки --------
+// Записи (имя, стандарт, «удалять», файл базы) лежат по алфавиту имени без учёта регистра.
+// Префикс имени — двоичный поиск по этому массиву, подстрока имени или стандарта —
+// пересечение списков триграмм запроса с проверкой кандидатов. Правки уходят в журнал
+// базы (в тот же файл, где запись определена) и применяются к индексу сразу.
+class ComponentSearch {
+public:
+    struct Entry { std::string name, standard, file; bool to_delete = false; };
+
+    void build(std::vector<Entry> entries) {
+        std::vector<std::pair<std::string, uint32_t>> order;
+        order.reserve(entries.size());
+        for (uint32_t i = 0; i < entries.size(); ++i) order.emplace_back(tolower_copy(entries[i].name), i);
+        std::sort(order.begin(), order.end());
+        entries_.clear();
+        entries_.reserve(entries.size());
+        for (const auto& o : order) entries_.push_back(std::move(entries[o.second]));
+        reindex();
+    }
+
+    size_t size() const { return entries_.size(); }
+    const Entry& operator[](size_t id) const { return entries_[id]; }
+
+    // изменить запись; индекс пересобирается в reindex() (после пачки правок)
+    void set(size_t id, const CompInfo& info) {
+        entries_[id].standard = info.standard;
+        entries_[id].to_delete = info.to_delete;
+    }
+
+    void reindex() {
+        names_.clear(); standards_.clear(); grams_.clear(); byStandard_.clear();
+        names_.reserve(entries_.size()); standards_.reserve(entries_.size());
+        std::vector<uint32_t> grams;
+        for (uint32_t id = 0; id < entries_.size(); ++id) {
+            names_.push_back(tolower_copy(entries_[id].name));
+            standards_.push_back(tolower_copy(entries_[id].standard));
+            grams.clear();
+            trigrams(names_.back(), grams);
+            trigrams(standards_.back(), grams);
+            std::sort(grams.begin(), grams.end());
+            grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+            for (uint32_t g : grams) grams_[g].push_back(id);
+            if (!standards_.back().empty()) byStandard_[standards_.back()].push_back(id);
+        }
+    }
+
+    // query (без учёта регистра) — начало имени или часть имени/стандарта. Сначала имена,
+    // начинающиеся с query, затем остальные совпадения; внутри — по алфавиту. limit = 0 — все;
+    // total — сколько подошло всего
+    std::vector<size_t> find(std::string_view query, size_t limit, size_t* total = nullptr) const {
+        const std::string q = tolower_copy(std::string(query));
+        std::vector<size_t> out;
+        size_t count = 0;
+        auto take = [&](size_t id) { ++count; if (!limit || out.size() < limit) out.push_back(id); };
+
+        // префикс — непрерывный отрезок отсортированных имён
+        const auto lo = std::lower_bound(names_.begin(), names_.end(), q);
+        auto hi = lo;
+        while (hi != names_.end() && hi->compare(0, q.size(), q) == 0) ++hi;
+        const size_t first = (size_t)(lo - names_.begin()), last = (size_t)(hi - names_.begin());
+        for (size_t id = first; id < last; ++id) take(id);
+
+        auto contains = [&](size_t id) {
+            return names_[id].find(q) != std::string::npos || standards_[id].find(q) != std::string::npos;
+        };
+        if (q.size() < 3) {                                 // триграмм нет — просмотр всех
+            for (size_t id = 0; id < entries_.size(); ++id)
+                if ((id < first || id >= last) && contains(id)) take(id);
+        } else {
+            std::vector<uint32_t> grams;
+            trigrams(q, grams);
+            std::vector<const std::vector<uint32_t>*> lists;
+            for (uint32_t g : grams) {
+                auto it = grams_.find(g);
+                if (it == grams_.end()) { lists.clear(); break; }
+                lists.push_back(&it->second);
+            }
+            if (lists.size() == grams.size()) {
+                std::sort(lists.begin(), lists.end(), [](auto a, auto b) { return a->size() < b->size(); });
+                for (uint32_t id : *lists[0]) {             // самый короткий список — кандидаты
+                    if (id >= first && id < last) continue;
+                    bool all = true;
+                    for (size_t k = 1; all && k < lists.size(); ++k)
+                        all = std::binary_search(lists[k]->begin(), lists[k]->end(), id);
+                    if (all && contains(id)) take(id);
+                }
+            }
+        }
+        if (total) *total = count;
+        return out;
+    }
+
+    // все записи с этим стандартом (без учёта регистра)
+    std::vector<size_t> withStandard(std::string_view standard) const {
+        auto it = byStandard_.find(tolower_copy(std::string(trim_view(standard))));
+        return it == byStandard_.end() ? std::vector<size_t>() : std::vector<size_t>(it->second.begin(), it->second.end());
+    }
+
+private:
+    static void trigrams(const std::string& s, std::vector<uint32_t>& out) {
+        for (size_t i = 0; i + 3 <= s.size(); ++i)
+            out.push_back((uint32_t)(unsigned char)s[i] << 16 | (uint32_t)(unsigned char)s[i + 1] << 8 | (unsigned char)s[i + 2]);
+    }
+
+    std::vector<Entry> entries_;
+    std::vector<std::string> names_, standards_;   // lower(), в порядке entries_
+    std::unordered_map<uint32_t, std::vector<uint32_t>> grams_;
+    std::unordered_map<std::string, std::vector<uint32_t>> byStandard_;
+};
+
+// записи базы с файлом, где каждая определена — как при загрузке: последний CSV, поверх — журнал
+static std::vector<ComponentSearch::Entry> loadComponentEntries() {
+    DbLock lock(DbLock::Mode::Shared);
+    std::vector<ComponentSearch::Entry> v;
+    std::unordered_map<std::string, size_t> byKey;
+    auto put = [&](std::string name, CompInfo info, std::string file) {
+        auto [it, inserted] = byKey.emplace(tolower_copy(name), v.size());
+        if (inserted) v.emplace_back();
+        v[it->second] = { std::move(name), std::move(info.standard), std::move(file), info.to_delete };
+    };
+    CsvReader reader;
+    for (const auto& path : listComponentDbFiles()) {
+        if (!reader.open(path)) continue;
+        const std::string file = fs::path(path).filename().string();
+        bool first = true;
+        while (reader.next()) {
+            if (first) { first = false; continue; } // заголовок
+            std::string name; CompInfo info;
+            if (parseDbRow(reader.cells(), name, info)) put(std::move(name), std::move(info), file);
+        }
+    }
+    for (auto& e : readJournal(journalPath())) put(std::move(e.nonstd), std::move(e.info), std::move(e.file));
+    return v;
+}
+
+// change(info) → true, если запись изменилась: такие — в журнал и в индекс. Возвращает число изменённых
+static size_t editComponents(ComponentSearch& search, const std::vector<size_t>& ids,
+                             const std::function<bool(CompInfo&)>& change) {
+    size_t changed = 0;
+    for (size_t id : ids) {
+        const auto& e = search[id];
+        CompInfo info{ e.standard, e.to_delete };
+        if (!change(info) || (info.standard == e.standard && info.to_delete == e.to_delete)) continue;
+        gDbJournal.add(JournalEntry{ e.name, info, e.file });
+        search.set(id, info);
+        ++changed;
+    }
+    if (changed) search.reindex();
+    return changed;
+}
+
+static std::string describeComponent(const ComponentSearch::Entry& e) {
+    return e.name + "  →  " + (e.to_delete ? "[удалять]" : e.standard.empty() ? "(как есть)" : e.standard) + "   [" + e.file + "]";
+}
+
+static constexpr size_t kSearchRows = 20; // строк результата на экране
+
+static std::string askLine(const std::string& prompt) {
+    std::cout << prompt;
+    std::string s;
+    std::getline(std::cin, s);
+    return trim(s);
+}
+
+// Tab в окне поиска: правка выбранной записи и массовые операции над найденным
+static bool componentActions(ComponentSearch& search, const std::string& query, const std::vector<size_t>& hits, size_t sel) {
+    size_t total = 0;
+    const std::vector<size_t> all = search.find(query, 0, &total);
+    const std::string cur = hits.empty() ? "" : search[hits[sel]].name;
+    std::vector<std::string> items = {
+        "Изменить: " + (cur.empty() ? "(нет записи)" : cur),
+        "Найденные (" + std::to_string(total) + "): заменить стандарт на ...",
+        "Найденные (" + std::to_string(total) + "): удалять",
+        "Найденные (" + std::to_string(total) + "): не удалять",
+        "Переназначить стандарт: все записи одного стандарта → другой",
+        "Назад",
+        "Выход"
+    };
+    int idx;
+    while ((idx = selectIndex(items, "=== База компонентов: действия ===")) == -2) {}
+    std::cout << "\x1b[2J\x1b[H";
+    size_t changed = 0;
+    switch (idx) {
+        case 0: {
+            if (cur.empty()) return true;
+            const auto& e = search[hits[sel]];
+            std::cout << describeComponent(e) << "\n";
+            const std::string st = askLine("Стандартное имя (Enter — оставить \"" + e.standard + "\"): ");
+            const bool del = askYesNo("Удалять строки с этим компонентом?", !e.to_delete);
+            changed = editComponents(search, { hits[sel] }, [&](CompInfo& i) {
+                if (!st.empty()) i.standard = st;
+                i.to_delete = del;
+                return true;
+            });
+            break;
+        }
+        case 1: {
+            const std::string st = askLine("Новое стандартное имя для " + std::to_string(total) + " записей: ");
+            if (!st.empty() && askYesNo("Заменить?"))
+                changed = editComponents(search, all, [&](CompInfo& i) { i.standard = st; return true; });
+            break;
+        }
+        case 2: case 3:
+            if (askYesNo(std::string(idx == 2 ? "Отметить «удалять»" : "Снять «удалять»") + " у " + std::to_string(total) + " записей?"))
+                changed = editComponents(search, all, [&](CompInfo& i) { i.to_delete = idx == 2; return true; });
+            break;
+        case 4: {
+            const std::string from = askLine("Старый стандарт" + (cur.empty() ? std::string() : " (Enter — \"" + search[hits[sel]].standard + "\")") + ": ");
+            const std::string old = from.empty() && !cur.empty() ? search[hits[sel]].standard : from;
+            const auto ids = search.withStandard(old);
+            std::cout << "Записей со стандартом \"" << old << "\": " << ids.size() << "\n";
+            const std::string to = ids.empty() ? "" : askLine("Новый стандарт: ");
+            if (!to.empty()) changed = editComponents(search, ids, [&](CompInfo& i) { i.standard = to; return true; });
+            break;
+        }
+        case 6: return false;
+        default: return true;
+    }
+    if (changed) gDbJournal.flush();
+    std::cout << "Изменено записей: " << changed << "\nНажмите Enter...";
+    std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    return true;
 }
+
 static void databaseOfComponents() {
-    std::cout << "[Database of components] недоступно в этой версии.\n";
-    std::cout << "Нажмите Enter..."; std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    ComponentSearch search;
+    search.build(loadComponentEntries());
+    std::string query;
+    size_t sel = 0;
+    std::cout << "\x1b[2J";
+    while (true) {
+        size_t total = 0;
+        const auto hits = search.find(query, kSearchRows, &total);
+        if (sel >= hits.size()) sel = hits.empty() ? 0 : hits.size() - 1;
+
+        std::cout << "\x1b[H=== База компонентов (" << search.size() << " записей) ===\n\n"
+                  << "\x1b[KПоиск: " << query << "\n\x1b[KНайдено: " << total << "\n\n";
+        for (size_t i = 0; i < kSearchRows; ++i) {
+            std::cout << "\x1b[K";
+            if (i < hits.size()) {
+                const std::string line = describeComponent(search[hits[i]]);
+                if (i == sel) std::cout << "\x1b[7m" << line << "\x1b[0m";
+                else          std::cout << line;
+            }
+            std::cout << "\n";
+        }
+        std::cout << "\n\x1b[KНабор — поиск по имени и стандарту, Up/Down — выбор, Enter/Tab — действия\n";
+        std::cout.flush();
+
+        char ch = 0;
+        switch (readKey(&ch)) {
+            case Key::Up:        if (sel > 0) --sel; break;
+            case Key::Down:      if (sel + 1 < hits.size()) ++sel; break;
+            case Key::Backspace:                            // целый символ UTF-8
+                while (!query.empty() && (query.back() & 0xC0) == 0x80) query.pop_back();
+                if (!query.empty()) query.pop_back();
+                sel = 0;
+                break;
+            case Key::Char:
+                if (ch != '\t') { query.push_back(ch); sel = 0; break; }
+                [[fallthrough]];
+            case Key::Enter:
+                if (!componentActions(search, query, hits, sel)) { finishDbSession(); return; }
+                std::cout << "\x1b[2J";
+                break;
+            default: break;
+        }
+    }
+}
+
+// --query: найденные записи — CSV в stdout (как файлы базы + столбец файла)
+static int runQuery(const std::string& query, size_t limit) {
+    ComponentSearch search;
+    search.build(loadComponentEntries());
+    size_t total = 0;
+    const auto hits = search.find(query, limit, &total);
+    std::string buf;
+    std::vector<std::string> header = kDbColumns;
+    header.push_back("Components_File");
+    appendCsvRow(buf, header, Quoting::Full);
+    for (size_t id : hits) {
+        const auto& e = search[id];
+        appendCsvRow(buf, std::vector<std::string>{ e.name, e.standard, e.to_delete ? "1" : "0", e.file }, Quoting::Full);
+    }
+    std::cout << buf;
+    if (hits.size() < total) std::cerr << "Показано " << hits.size() << " из " << total << " (--limit 0 — все)\n";
+    return 0;
+}
+
+// -------- Пакетный режим (без меню) --------
+static void printUsage(const char* argv0) {
+    std::cout <<
+        "Usage:\n"
+        "  " << argv0 << "                          интерактивное меню\n"
+        "  " << argv0 << " [options] <dir|file>...  пакетная конвертация без вопросов\n"
+        "  " << argv0 << " --review [options]       разобрать очередь неизвестных компонентов\n"
+        "  " << argv0 << " --apply  [options]       внести в базу вручную заполненные строки очереди\n"
+        "  " << argv0 << " --compact [-c DIR]       сжать базу: журнал → CSV, сортировка, без повторов\n"
+        "  " << argv0 << " --watch [options] [dir]  следить за папкой и конвертировать новые/изменённые файлы\n"
+        "  " << argv0 << " --compare RESULT DOC     сверить результат с документацией (BOM); код 3 — есть расхождения\n"
+        "  " << argv0 << " --query TEXT [-c DIR]    найти в базе записи, где TEXT — часть имени или стандарта\n"
+        "\nOptions:\n"
+        "  -o, --output DIR       папка результатов (по умолчанию \"Converted\")\n"
+        "  -c, --components DIR   папка базы компонентов (по умолчанию \"Components\")\n"
+        "  -p, --pending FILE     очередь неизвестных (по умолчанию " << kPendingFile << ")\n"
+        "  -j, --jobs N           число потоков (по умолчанию — по числу ядер)\n"
+        "      --no-atomic        писать результат сразу в целевой файл, без временного\n"
+        "      --stats FILE       записать статистику запуска (JSON: счётчики строк, время этапов)\n"
+        "      --force            конвертировать всё, не глядя в " << kManifestFile << "\n"
+        "      --summary          сводка: RESULT.summary.csv по каждому файлу и Summary.json в папке результатов\n"
+        "      --columnar         рядом с результатом — RESULT.cols: столбцы для чтения через mmap без разбора\n"
+        "      --debounce MS      --watch: файл готов, если не менялся MS мс (по умолчанию 500)\n"
+        "      --report FILE      --compare: куда записать отчёт (по умолчанию RESULT.diff.csv)\n"
+        "      --limit N          --query: не больше N записей (по умолчанию 50, 0 — все)\n"
+        "  -h, --help             эта справка\n";
+}
+
+static int runBatch(const std::vector<std::string>& inputs, const std::string& outDir, const std::string& pendingPath,
+                    const std::string& statsPath, bool force, bool summary, bool columnar) {
+    using clock = std::chrono::steady_clock;
+    const auto t0 = clock::now();
+    auto nsSince = [](clock::time_point t) {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - t).count();
+    };
+    RunStats run;
+    run.startedAt = utcTimestamp();
+
+    std::vector<std::string> files;
+    for (const auto& in : inputs) {
+        if (fs::is_directory(in)) {
+            auto v = listFiles(in);
+            files.insert(files.end(), v.begin(), v.end());
+        } else if (fs::is_regular_file(in)) {
+            files.push_back(in);
+        } else {
+            std::cerr << "Нет такого файла или папки: " << in << "\n";
+        }
+    }
+    if (files.empty()) { std::cerr << "Нет файлов для конвертации.\n"; return 1; }
+
+    PendingQueue pending = loadPendingQueue(pendingPath);
+    const auto tDb = clock::now();
+    const auto dbMap = loadComponentsDb();
+    run.dbLoadNs  = nsSince(tDb);
+    run.dbEntries = dbMap.size();
+    run.threads   = jobCount(files.size());
+    ConversionManifest manifest;
+    if (!force) manifest.load(kManifestFile); // --force: всё заново, манифест перезаписывается
+    size_t skipped = 0;
+    std::vector<BomSummary> summaries;
+    const size_t ok = convertBatch(files, outDir, dbMap, pending, statsPath.empty() ? nullptr : &run.files,
+                                   &manifest, &skipped, summary ? &summaries : nullptr, columnar);
+    manifest.pruneMissing();
+    if (!manifest.save(kManifestFile)) std::cerr << "Не удалось записать " << kManifestFile << "\n";
+
+    prunePendingQueue(pending, dbMap);
+    savePendingQueue(pendingPath, pending);
+
+    std::cout << "Готово: " << ok << "/" << files.size() << " успешно (без изменений: " << skipped << ").\n"
+              << "Кэш нормализации: " << gNormalizeCache.hits() << " попаданий, "
+              << gNormalizeCache.misses() << " промахов\n";
+    if (!pending.items.empty())
+        std::cout << "Неизвестных компонентов: " << pending.items.size() << " → " << pendingPath << "\n";
+    if (summary) {
+        if (saveBatchSummaries(outDir, summaries))
+            std::cout << "Сводка → " << (fs::path(outDir) / "Summary.json").string() << "\n";
+        else
+            std::cerr << "Сводка записана не полностью\n";
+    }
+    if (!statsPath.empty()) {
+        run.wallNs = nsSince(t0);
+        if (!saveRunStats(statsPath, run, gNormalizeCache.hits(), gNormalizeCache.misses()))
+            std::cerr << "Не удалось записать статистику " << statsPath << "\n";
+        else
+            std::cout << "Статистика → " << statsPath << "\n";
+    }
+    return ok == files.size() ? 0 : 1;
+}
+
+// -------- Режим наблюдения (--watch) --------
+// Папки входа просматриваются постоянно (Linux — inotify, иначе — опрос раз в debounce).
+// Файл конвертируется, когда события по нему стихли на debounce мс и его размер/mtime
+// не изменились между двумя проверками. Правила и индекс базы держатся в памяти; при
+// изменении Components/ индекс пересобирается в потоке наблюдения и подменяется целиком:
+// идущая конвертация дорабатывает со старым, следующая берёт новый. После подмены все
+// входные файлы сверяются с манифестом — пересобираются только те, чьи записи изменились.
+static volatile std::sig_atomic_t gStopWatch = 0;
+static void onStopSignal(int) { gStopWatch = 1; }
+
+static std::string localClock() {
+    const std::time_t t = std::time(nullptr);
+    std::tm tm{};
+#ifdef _WIN32
+    localtime_s(&tm, &t);
+#else
+    localtime_r(&t, &tm);
+#endif
+    char b[16];
+    std::strftime(b, sizeof b, "%H:%M:%S", &tm);
+    return b;
+}
+
+// изменившиеся пути в наблюдаемых папках; wait ждёт не дольше timeoutMs
+class DirWatcher {
+public:
+    DirWatcher(const DirWatcher&) = delete;
+    DirWatcher& operator=(const DirWatcher&) = delete;
+#ifdef __linux__
+    DirWatcher() : fd_(inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) {}
+    ~DirWatcher() { if (fd_ >= 0) ::close(fd_); }
+
+    bool add(const std::string& dir) {
+        if (fd_ < 0) return false;
+        const int wd = inotify_add_watch(fd_, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_MODIFY |
+                                                           IN_DELETE | IN_MOVED_FROM);
+        if (wd < 0) return false;
+        dirs_[wd] = dir;
+        return true;
+    }
+
+    std::vector<std::string> wait(int timeoutMs) {
+        std::vector<std::string> changed;
+        pollfd pfd{ fd_, POLLIN, 0 };
+        if (::poll(&pfd, 1, timeoutMs) <= 0) return changed; // тайм-аут или сигнал
+        alignas(inotify_event) char buf[16 * 1024];
+        ssize_t n;
+        while ((n = ::read(fd_, buf, sizeof buf)) > 0) {
+            for (char* p = buf; p < buf + n; ) {
+                const auto* ev = reinterpret_cast<const inotify_event*>(p);
+                auto it = dirs_.find(ev->wd);
+                if (it != dirs_.end() && ev->len > 0)
+                    changed.push_back((fs::path(it->second) / ev->name).string());
+                p += sizeof(inotify_event) + ev->len;
+            }
+        }
+        return changed;
+    }
+
+private:
+    int fd_;
+    std::unordered_map<int, std::string> dirs_;
+#else
+    DirWatcher() = default;
+
+    bool add(const std::string& dir) {
+        if (!fs::is_directory(dir)) return false;
+        dirs_.push_back(dir);
+        scan(dir, stamps_);
+        return true;
+    }
+
+    std::vector<std::string> wait(int timeoutMs) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(timeoutMs));
+        std::unordered_map<std::string, std::pair<uint64_t, int64_t>> now;
+        for (const auto& d : dirs_) scan(d, now);
+        std::vector<std::string> changed;
+        for (const auto& [path, st] : now) {
+            auto it = stamps_.find(path);
+            if (it == stamps_.end() || it->second != st) changed.push_back(path);
+        }
+        for (const auto& kv : stamps_) if (!now.count(kv.first)) changed.push_back(kv.first);
+        stamps_ = std::move(now);
+        return changed;
+    }
+
+private:
+    static void scan(const std::string& dir, std::unordered_map<std::string, std::pair<uint64_t, int64_t>>& out) {
+        std::error_code ec;
+        for (const auto& e : fs::directory_iterator(dir, ec)) {
+            if (!e.is_regular_file(ec)) continue;
+            const std::string path = e.path().string();
+            out[path] = { e.file_size(ec), fileMtime(path) };
+        }
+    }
+    std::vector<std::string> dirs_;
+    std::unordered_map<std::string, std::pair<uint64_t, int64_t>> stamps_;
+#endif
+};
+
+// поток конвертации: забирает готовые файлы пачками, база — та, что актуальна на начало пачки;
+// columnar — как --columnar в пакетном режиме (файл без свежего .cols тоже конвертируется)
+class WatchConverter {
+public:
+    WatchConverter(std::string outDir, std::string pendingPath, const ComponentDbStore& store, bool columnar)
+        : outDir_(std::move(outDir)), pendingPath_(std::move(pendingPath)), store_(store), columnar_(columnar) {
+        manifest_.load(kManifestFile);
+        thread_ = std::thread([this] { run(); });
+    }
+    ~WatchConverter() {
+        { std::lock_guard<std::mutex> lk(m_); stop_ = true; }
+        cv_.notify_all();
+        thread_.join();
+    }
+
+    void submit(const std::string& file) {
+        { std::lock_guard<std::mutex> lk(m_); if (std::find(ready_.begin(), ready_.end(), file) == ready_.end()) ready_.push_back(file); }
+        cv_.notify_all();
+    }
+
+private:
+    void run() {
+        std::unique_lock<std::mutex> lk(m_);
+        while (true) {
+            cv_.wait(lk, [&] { return stop_ || !ready_.empty(); });
+            if (ready_.empty()) return; // stop_ и всё сделано
+            std::vector<std::string> queued;
+            queued.swap(ready_);
+            std::sort(queued.begin(), queued.end());
+            lk.unlock();
+            const std::shared_ptr<const ComponentDb> db = store_.current();
+
+            // несвежие по манифесту отсеиваются молча; их неизвестные уже лежат в очереди
+            std::vector<std::string> batch;
+            for (const auto& f : queued) {
+                const std::string out = outputPath(outDir_, f);
+                if (!manifest_.upToDate(f, out, *db) || (columnar_ && !columnarFresh(out))) batch.push_back(f);
+            }
+            if (batch.empty()) { lk.lock(); continue; }
+
+            PendingQueue pending = loadPendingQueue(pendingPath_);
+            const size_t ok = convertBatch(batch, outDir_, *db, pending, nullptr, &manifest_, nullptr, nullptr, columnar_);
+            manifest_.pruneMissing();
+            if (!manifest_.save(kManifestFile)) std::cerr << "Не удалось записать " << kManifestFile << "\n";
+            prunePendingQueue(pending, *db);
+            savePendingQueue(pendingPath_, pending);
+            std::cout << "[" << localClock() << "] готово: " << ok << "/" << batch.size()
+                      << ", неизвестных в очереди: " << pending.items.size() << "\n";
+            std::cout.flush();
+
+            lk.lock();
+        }
+    }
+
+    std::string outDir_, pendingPath_;
+    ConversionManifest manifest_;  // только в потоке конвертации
+    std::mutex m_;
+    std::condition_variable cv_;
+    std::vector<std::string> ready_;
+    const ComponentDbStore& store_;     // новая версия базы подхватывается со следующей пачки
+    const bool columnar_;
+    bool stop_ = false;
+    std::thread thread_;
+};
+
+static int runWatch(const std::vector<std::string>& inputs, const std::string& outDir, const std::string& pendingPath,
+                    unsigned debounceMs, bool columnar) {
+    using clock = std::chrono::steady_clock;
+    std::vector<std::string> dirs;
+    for (const auto& in : inputs) {
+        if (fs::is_directory(in)) dirs.push_back(in);
+        else std::cerr << "Наблюдать можно только папку: " << in << "\n";
+    }
+    if (dirs.empty()) return 1;
+
+    DirWatcher watcher;
+    for (const auto& d : dirs)
+        if (!watcher.add(d)) { std::cerr << "Не удалось наблюдать за " << d << "\n"; return 1; }
+    fs::create_directories(kComponentsDir);
+    const bool watchDb = watcher.add(kComponentsDir);
+    if (!watchDb) std::cerr << "Не удалось наблюдать за " << kComponentsDir << " — база не будет перезагружаться\n";
+
+    std::signal(SIGINT, onStopSignal);
+    std::signal(SIGTERM, onStopSignal);
+
+    ComponentDbStore store(loadComponentsDb());
+    std::cout << "[" << localClock() << "] наблюдение: ";
+    for (size_t i = 0; i < dirs.size(); ++i) std::cout << (i ? ", " : "") << dirs[i];
+    std::cout << " → " << outDir << " (база: " << store.current()->size() << " записей; Ctrl+C — выход)\n";
+
+    WatchConverter converter(outDir, pendingPath, store, columnar);
+    auto sweep = [&] { // всё, что есть в папках; несвежие по манифесту файлы будут пропущены
+        for (const auto& d : dirs) for (const auto& f : listFiles(d)) converter.submit(f);
+    };
+    sweep();
+
+    // путь → (срок, размер/mtime при последней проверке)
+    struct Settling { clock::time_point due; uint64_t size = UINT64_MAX; int64_t mtime = 0; };
+    std::unordered_map<std::string, Settling> settling;
+    const std::string dbKey = "\x01components";
+    const fs::path componentsDir = fs::absolute(kComponentsDir).lexically_normal();
+    const auto debounce = std::chrono::milliseconds(debounceMs);
+
+    while (!gStopWatch) {
+        int timeout = (int)debounceMs;
+        const auto now = clock::now();
+        for (const auto& kv : settling)
+            timeout = std::min<int>(timeout, (int)std::max<int64_t>(0,
+                std::chrono::duration_cast<std::chrono::milliseconds>(kv.second.due - now).count()));
+
+        for (const auto& path : watcher.wait(timeout)) {
+            const fs::path p(path);
+            const std::string name = p.filename().string();
+            if (name.empty() || name[0] == '.') continue; // временные файлы (свои и чужие)
+            if (fs::absolute(p).parent_path().lexically_normal() == componentsDir) {
+                if (p.extension() == ".csv" || name == fs::path(journalPath()).filename().string())
+                    settling[dbKey].due = clock::now() + debounce;
+                continue;
+            }
+            if (!hasExtension(p, kExts)) continue;
+            settling[path].due = clock::now() + debounce;
+        }
+
+        const auto t = clock::now();
+        for (auto it = settling.begin(); it != settling.end(); ) {
+            if (it->second.due > t) { ++it; continue; }
+            if (it->first == dbKey) {
+                const auto t0 = clock::now();
+                auto fresh = std::make_shared<const ComponentDb>(loadComponentsDb());
+                const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(clock::now() - t0).count();
+                std::cout << "[" << localClock() << "] база перезагружена: " << fresh->size() << " записей (" << ms << " мс)\n";
+                store.publish(std::move(fresh));
+                sweep();
+                it = settling.erase(it);
+                continue;
+            }
+            std::error_code ec;
+            if (!fs::is_regular_file(it->first, ec)) { it = settling.erase(it); continue; } // удалён
+            const uint64_t size = fs::file_size(it->first, ec);
+            const int64_t mtime = fileMtime(it->first);
+            if (size != it->second.size || mtime != it->second.mtime) { // ещё пишется — проверить позже
+                it->second = { t + debounce, size, mtime };
+                ++it;
+                continue;
+            }
+            converter.submit(it->first);
+            it = settling.erase(it);
+        }
+    }
+    std::cout << "[" << localClock() << "] остановка...\n";
+    return 0;
+}
+
+// один проход по очереди (см. resolvePending)
+static int reviewPending(const std::string& pendingPath, bool interactive) {
+    PendingQueue q = loadPendingQueue(pendingPath);
+    if (q.items.empty()) { std::cout << "Очередь пуста: " << pendingPath << "\n"; return 0; }
+
+    ComponentDbStore store(loadComponentsDb());
+    const size_t total = q.items.size();
+    PendingQueue left = resolvePending(q, store, interactive);
+    if (!finishDbSession()) return 1;
+
+    savePendingQueue(pendingPath, left);
+    std::cout << "Разобрано: " << (total - left.items.size()) << ", осталось: " << left.items.size() << "\n";
+    return 0;
+}
+
+static int runCli(int argc, char** argv) {
+    enum class Mode { Batch, Review, Apply, Compact, Watch, Compare, Query } mode = Mode::Batch;
+    std::vector<std::string> inputs;
+    std::string outDir = "Converted", pendingPath = kPendingFile, statsPath, reportPath;
+    bool force = false, summary = false, columnar = false;
+    unsigned debounceMs = 500;
+    std::string query;
+    size_t limit = 50;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string a = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) { std::cerr << "Нет значения для " << a << "\n"; std::exit(2); }
+            return argv[++i];
+        };
+        if      (a == "-h" || a == "--help")       { printUsage(argv[0]); return 0; }
+        else if (a == "-o" || a == "--output")     outDir = value();
+        else if (a == "-c" || a == "--components") kComponentsDir = value();
+        else if (a == "-p" || a == "--pending")    pendingPath = value();
+        else if (a == "-j" || a == "--jobs")       gJobs = (unsigned)std::strtoul(value().c_str(), nullptr, 10);
+        else if (a == "--no-atomic")               gAtomicWrites = false;
+        else if (a == "--stats")                   statsPath = value();
+        else if (a == "--force")                   force = true;
+        else if (a == "--summary")                 summary = true;
+        else if (a == "--columnar")                columnar = true;
+        else if (a == "--review")                  mode = Mode::Review;
+        else if (a == "--apply")                   mode = Mode::Apply;
+        else if (a == "--compact")                 mode = Mode::Compact;
+        else if (a == "--watch")                   mode = Mode::Watch;
+        else if (a == "--compare")                 mode = Mode::Compare;
+        else if (a == "--report")                  reportPath = value();
+        else if (a == "--query")                   { mode = Mode::Query; query = value(); }
+        else if (a == "--limit")                   limit = std::strtoul(value().c_str(), nullptr, 10);
+        else if (a == "--debounce")                debounceMs = std::max(50ul, std::strtoul(value().c_str(), nullptr, 10));
+        else if (!a.empty() && a[0] == '-')        { std::cerr << "Неизвестный параметр: " << a << "\n"; printUsage(argv[0]); return 2; }
+        else                                       inputs.push_back(a);
+    }
+
+    enableVTMode();
+    if (!loadRules()) return 1;
+    switch (mode) {
+        case Mode::Review: return reviewPending(pendingPath, /*interactive=*/true);
+        case Mode::Apply:  return reviewPending(pendingPath, /*interactive=*/false);
+        case Mode::Compact: {
+            CompactReport rep;
+            if (!compactComponentsDb(rep)) return 1;
+            printCompactReport(rep);
+            return 0;
+        }
+        case Mode::Watch:
+            // Summary.json — итог одного запуска, у наблюдения его нет
+            if (summary) { std::cerr << "--summary не работает с --watch: сводка собирается по одному пакетному запуску\n"; return 2; }
+            if (inputs.empty()) inputs.push_back(kFolder);
+            return runWatch(inputs, outDir, pendingPath, debounceMs, columnar);
+        case Mode::Compare:
+            if (inputs.size() != 2) { std::cerr << "--compare: нужны два файла — результат и документация\n"; return 2; }
+            return runCompare(inputs[0], inputs[1], reportPath);
+        case Mode::Query:  return runQuery(query, limit);
+        case Mode::Batch:  break;
+    }
+    if (inputs.empty()) inputs.push_back(kFolder);
+    return runBatch(inputs, outDir, pendingPath, statsPath, force, summary, columnar);
 }
 
 // -------- main --------
-int main() {
+int main(int argc, char** argv) {
+    if (argc > 1) return runCli(argc, argv); // пакетный режим без меню
+
     if (Initialisation() != 0) return 1;  // важна успешная инициализация
+    if (!loadRules()) return 1;           // Settings/Normalize.rules
 
     enableVTMode(); // ANSI + UTF-8
 
@@ -621,4 +6035,4 @@ int main() {
     }
     return 0;
 }
-
+#endif // ALTIUM_CONVERTER_NO_MAIN
@@ -0,0 +1,266 @@
+// Дифференциальная проверка правил нормализации: normalizeCell на встроенных правилах
+// (kDefaultRules, сопоставитель без std::regex) против прежней реализации на std::regex,
+// которая была зашита в код до появления Settings/Normalize.rules.
+//
+//   g++ -std=c++17 -O2 -pthread -o rules_check RulesCheck.cpp
+//   ./rules_check --cases 300000 --seed 1
+//
+// Ячейки генерируются вокруг правил (корпуса конденсаторов и резисторов, скобки, запятые,
+// '?', '%', LESR, кириллица, пробелы/табуляции/\r, неразрывный пробел и длинные тире) плюс
+// случайный мусор. Первые расхождения печатаются, код возврата 1 — если расхождения есть.
+
+#define ALTIUM_CONVERTER_NO_MAIN
+#include "MasterFile.cpp"
+
+#include <cstdio>
+#include <random>
+#include <regex>
+
+// -------- Прежняя реализация (std::regex) --------
+namespace reference {
+
+static inline std::string ltrim(const std::string& s) {
+    size_t i = 0; while (i < s.size() && (s[i] == ' ' || s[i] == '\t')) ++i; return s.substr(i);
+}
+static inline std::string rtrim(const std::string& s) {
+    size_t j = s.size(); while (j > 0 && (s[j - 1] == ' ' || s[j - 1] == '\t')) --j; return s.substr(0, j);
+}
+static inline std::string trim(const std::string& s) { return rtrim(ltrim(s)); }
+static inline std::string tolower_copy(std::string s) {
+    std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return std::tolower(c); });
+    return s;
+}
+
+static std::string normalizeChipCapacitor(const std::string& in) {
+    using std::regex; using std::regex_replace; using std::regex_constants::icase;
+    std::string s = in;
+
+    // 0402|0603|0805|1206|1210 - X5R|X7R - <VOLTAGE...> → корпус-<VOLTAGE...>
+    static const regex re_x5x7(R"(^\s*(0402|0603|0805|1206|1210)\s*-\s*(X5R|X7R)\s*-\s*([0-9]+V-.*)$)", icase);
+    if (std::regex_match(s, re_x5x7)) return regex_replace(s, re_x5x7, "$1-$3");
+
+    // 0402|... - NP0 - <VOLTAGE...> → корпус-N<VOLTAGE...>
+    static const regex re_np0(R"(^\s*(0402|0603|0805|1206|1210)\s*-\s*NP0\s*-\s*([0-9]+V-.*)$)", icase);
+    if (std::regex_match(s, re_np0)) return regex_replace(s, re_np0, "$1-N$2");
+
+    return s;
+}
+
+// Резисторы: <Pkg>-<Power W>-<Value>-<ppm>[-<tol%>] → убрать -ppm-, tol оставить
+static std::string normalizeResistor(const std::string& in) {
+    using std::regex; using std::smatch; using std::string;
+
+    static const regex re(
+        R"(^\s*([^- \t]+)\s*-\s*([0-9]+(?:\.[0-9]+)?|[0-9]+/[0-9]+)\s*W\s*-\s*(0R|[0-9]+(?:\.[0-9]+)?[RKM])\s*-\s*[0-9]+\s*ppm(?:\s*-\s*([0-9]+%))?\s*$)",
+        std::regex::icase
+    );
+    smatch m;
+    if (!std::regex_search(in, m, re)) return in;
+
+    string out = m[1].str() + "-" + m[2].str() + "W-" + m[3].str();
+    if (m[4].matched && !m[4].str().empty()) out += "-" + m[4].str();
+    return out;
+}
+
+// Заменяет визуально похожие кириллические буквы на латинские (UTF-8 → ASCII)
+static std::string oldFixCyrillicLetters(std::string s) {
+    static const std::pair<const char*, const char*> map[] = {
+        {u8"А", "A"}, {u8"В", "B"}, {u8"Е", "E"}, {u8"К", "K"},
+        {u8"М", "M"}, {u8"Н", "H"}, {u8"О", "O"}, {u8"Р", "P"},
+        {u8"С", "C"}, {u8"Т", "T"}, {u8"У", "Y"}, {u8"Х", "X"},
+        {u8"а", "a"}, {u8"в", "b"}, {u8"е", "e"}, {u8"к", "k"},
+        {u8"м", "m"}, {u8"н", "n"}, {u8"о", "o"}, {u8"р", "p"},
+        {u8"с", "c"}, {u8"т", "t"}, {u8"у", "y"}, {u8"х", "x"}
+    };
+    for (const auto& p : map) {
+        const size_t from_len = std::strlen(p.first), to_len = std::strlen(p.second);
+        size_t pos = 0;
+        while ((pos = s.find(p.first, pos)) != std::string::npos) {
+            s.replace(pos, from_len, p.second);
+            pos += to_len;
+        }
+    }
+    return s;
+}
+
+// неразрывный/идеографический пробел и тире/минус → ASCII до всех шагов (в прежней
+// реализации их не было; так они ведут себя как пробел и '-')
+static std::string foldSpacesAndDashes(std::string s) {
+    static const std::pair<const char*, const char*> map[] = {
+        {u8"\u00A0", " "}, {u8"\u3000", " "}, {u8"\u2010", "-"}, {u8"\u2011", "-"}, {u8"\u2012", "-"},
+        {u8"\u2013", "-"}, {u8"\u2014", "-"}, {u8"\u2015", "-"}, {u8"\u2212", "-"}
+    };
+    for (const auto& p : map)
+        for (size_t pos = 0; (pos = s.find(p.first, pos)) != std::string::npos; ++pos)
+            s.replace(pos, std::strlen(p.first), p.second);
+    return s;
+}
+
+static std::string normalizeCell(const std::string& in) {
+    std::string s = foldSpacesAndDashes(in);
+
+    // удалить (...) фрагменты
+    static const std::regex paren_re(R"(\([^)]*\))");
+    s = std::regex_replace(s, paren_re, "");
+
+    for (char& c : s) if (c == ',') c = '.';
+    for (char& c : s) if (c == '?') c = '-';
+
+    // убрать пробелы перед тире
+    static const std::regex dash_space_re(R"(\s+-)");
+    s = std::regex_replace(s, dash_space_re, "-");
+
+    // обрезать всё после '%' (сам знак оставить)
+    if (size_t p = s.find('%'); p != std::string::npos) s = s.substr(0, p + 1);
+
+    // убрать всё до первой буквы/цифры/%
+    size_t pos = 0;
+    while (pos < s.size()) {
+        unsigned char ch = static_cast<unsigned char>(s[pos]);
+        if (std::isalnum(ch) || ch == '%') break;
+        ++pos;
+    }
+    if (pos > 0) s.erase(0, pos);
+
+    // если в исходнике было LESR — гарантировать его присутствие
+    if (tolower_copy(in).find("lesr") != std::string::npos) {
+        if (tolower_copy(s).find("lesr") == std::string::npos) {
+            if (!s.empty() && s.back() == '%') s += "LESR";
+            else                               s += " LESR";
+        }
+    }
+
+    s = trim(s);
+    s = normalizeChipCapacitor(s);
+    s = normalizeResistor(s);
+    // таблица транслитерации с тех пор расширена (греческие, полноширинные буквы, знаки
+    // единиц) — здесь текущая, общая с прежней часть сверяется отдельно (checkGlyphs)
+    s = ::fixCyrillicLetters(s);
+    return s;
+}
+
+} // namespace reference
+
+// -------- Генератор ячеек --------
+namespace {
+
+class Gen {
+public:
+    explicit Gen(uint64_t seed) : rng_(seed) {}
+
+    std::string cell() {
+        switch (rng_() % 4) {
+        case 0:  return capacitor();
+        case 1:  return resistor();
+        case 2:  return decorated();
+        default: return noise();
+        }
+    }
+
+private:
+    std::string pick(const std::vector<std::string>& v) { return v[rng_() % v.size()]; }
+    std::string sp() { return pick(kSpaces); }
+
+    std::string capacitor() {
+        return sp() + pick({ "0402", "0603", "0805", "1206", "1210", "0612", "SOT" }) + sp() + pick({ "-", "", "--", u8"–", u8"\u2212" }) + sp()
+             + pick({ "X5R", "x7r", "NP0", "np0", "NPO", "X8R", u8"Х7R" }) + sp() + pick({ "-", "" }) + sp()
+             + pick({ "50", "6", "", "a", "100" }) + pick({ "V", "v", "" }) + pick({ "-", "", " -" })
+             + pick({ "100nF", "", "10%", "\rx", "1uF-10%", "4.7uF (Murata)", u8"4.7uF\u00A0(Murata)", "1nF-LESR" });
+    }
+
+    std::string resistor() {
+        return sp() + pick({ "0603", "R", "A B", "x\ry", "0805", "-", u8"Р0402" }) + sp() + pick({ "-", "" }) + sp()
+             + pick({ "0.1", "1/16", "0.", "1/", "10", ".5", "0,1" }) + sp() + pick({ "W", "w", "" }) + sp() + pick({ "-", "" }) + sp()
+             + pick({ "0R", "0r", "10K", "4.7k", "1M", "4.", "0R5", "100R", "10", u8"10К" }) + sp() + pick({ "-", "" }) + sp()
+             + pick({ "100", "50", "" }) + sp() + pick({ "ppm", "PPM", "pp" })
+             + pick({ "", "-1%", " - 5%", "-1", "-1%x", "-%", " ", "?1%" });
+    }
+
+    // общие правила: скобки, запятые, '?', '%', LESR, мусор в начале
+    std::string decorated() {
+        std::string s;
+        const int parts = 1 + (int)(rng_() % 5);
+        for (int i = 0; i < parts; ++i)
+            s += pick({ "(Murata)", "(", ")", "((a)b)", "10,5", "?", "%", "50%-x", "lesr", "LeSr", " - ", "\t-",
+                        "STM32F405", u8"Конденсатор", u8"ХСК", "  ", ".-", "#", "_", "0603-X7R-50V-100nF",
+                        u8"—", u8"\u00A0", u8"\u3000-" }) + sp();
+        return s;
+    }
+
+    std::string noise() {
+        static const std::string alphabet = std::string(" \t\r\v-()%?,.;0123456789ARKMVWXNPpmlesr") + u8"АВЕКМНОРСТУХавекмнорстух";
+        std::string s;
+        const size_t n = rng_() % 24;
+        for (size_t i = 0; i < n; ++i) s += alphabet[rng_() % alphabet.size()];
+        return s; // в том числе обрывки UTF-8 — старая и новая реализации побайтовые
+    }
+
+    inline static const std::vector<std::string> kSpaces = { "", "", "", " ", "  ", "\t", " \t", "\r", "\v", u8"\u00A0" };
+    std::mt19937_64 rng_;
+};
+
+// прежние 24 кириллические буквы вперемешку с ASCII и прочей кириллицей: замены должны совпасть
+static size_t checkGlyphs(uint64_t seed, size_t cases) {
+    static const std::vector<std::string> toks = { "a", "Z", "0", " ", "-", u8"А", u8"В", u8"Е", u8"К", u8"М", u8"Н",
+        u8"О", u8"Р", u8"С", u8"Т", u8"У", u8"Х", u8"а", u8"в", u8"е", u8"к", u8"м", u8"н", u8"о", u8"р", u8"с",
+        u8"т", u8"у", u8"х", u8"Б", u8"я", u8"ё", u8"Ж" };
+    std::mt19937_64 rng(seed);
+    size_t diffs = 0;
+    for (size_t i = 0; i < cases; ++i) {
+        std::string s;
+        for (size_t k = rng() % 20; k > 0; --k) s += toks[rng() % toks.size()];
+        const std::string want = reference::oldFixCyrillicLetters(s), got = fixCyrillicLetters(s);
+        if (want != got && diffs++ < 20)
+            std::printf("РАСХОЖДЕНИЕ [%s]\n  прежняя таблица: [%s]\n  текущая:         [%s]\n", s.c_str(), want.c_str(), got.c_str());
+    }
+    return diffs;
+}
+
+// известные ячейки с неразрывным пробелом и длинным тире — как их ASCII-написание
+static size_t checkExamples(const ConversionRules& rules) {
+    static const std::pair<const char*, const char*> cases[] = {
+        { u8"0603 – X7R – 50V-100nF",               "0603-50V-100nF" },
+        { u8"0603-X7R-50V-100nF\u00A0(Murata)",     "0603-50V-100nF" },
+        { u8"0603\u00A0-\u00A0NP0\u00A0—\u00A050V-1nF", "0603-N50V-1nF" },
+        { u8"0402−X5R−16V−1uF",                     "0402-16V-1uF" },
+    };
+    size_t diffs = 0;
+    for (const auto& [cell, want] : cases) {
+        const std::string got = normalizeCell(cell, rules);
+        if (got != want && ++diffs)
+            std::printf("РАСХОЖДЕНИЕ [%s]\n  ожидалось: [%s]\n  правила:   [%s]\n", cell, want, got.c_str());
+    }
+    return diffs;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    uint64_t seed = 1;
+    size_t cases = 300000;
+    for (int i = 1; i < argc; ++i) {
+        const std::string a = argv[i];
+        if      (a == "--seed"  && i + 1 < argc) seed  = std::stoull(argv[++i]);
+        else if (a == "--cases" && i + 1 < argc) cases = std::stoull(argv[++i]);
+        else { std::cerr << "Использование: rules_check [--cases N] [--seed N]\n"; return 2; }
+    }
+
+    ConversionRules rules;
+    if (!compileRules(kDefaultRules, "kDefaultRules", rules)) return 2;
+
+    Gen gen(seed);
+    size_t diffs = 0, changed = 0;
+    for (size_t i = 0; i < cases; ++i) {
+        const std::string s = gen.cell();
+        const std::string want = reference::normalizeCell(s);
+        const std::string got = normalizeCell(s, rules);
+        changed += want != s;
+        if (want != got && diffs++ < 20)
+            std::printf("РАСХОЖДЕНИЕ [%s]\n  regex:  [%s]\n  правила: [%s]\n", s.c_str(), want.c_str(), got.c_str());
+    }
+    diffs += checkExamples(rules);
+    std::printf("ячеек %zu, изменено правилами %zu, расхождений %zu\n", cases, changed, diffs);
+    const size_t glyphDiffs = checkGlyphs(seed, cases);
+    std::printf("транслитерация: строк %zu, расхождений %zu\n", cases, glyphDiffs);
+    return diffs || glyphDiffs ? 1 : 0;
+}
@@ -0,0 +1,142 @@
+// Проверка чтения XLSX (Inflater, ZipArchive, XmlStream, XlsxReader) на эталонных книгах
+// из fixtures/xlsx — их состав описан в fixtures/xlsx/make_fixtures.py.
+//
+//   g++ -std=c++17 -O2 -pthread -o xlsx_check XlsxCheck.cpp
+//   ./xlsx_check fixtures/xlsx
+//
+// Каждая проверка печатает OK или ОШИБКА с причиной; код возврата 1 — если есть ошибки.
+
+#define ALTIUM_CONVERTER_NO_MAIN
+#include "MasterFile.cpp"
+
+namespace {
+
+int gFailures = 0;
+
+void report(const std::string& name, const std::string& error) {
+    if (error.empty()) { std::cout << "OK      " << name << "\n"; return; }
+    std::cout << "ОШИБКА  " << name << ": " << error << "\n";
+    ++gFailures;
+}
+
+std::string readFile(const fs::path& p) {
+    std::ifstream f(p, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(f), {});
+}
+
+// строки первого листа — как их запишет конвертер (';', кавычки по необходимости)
+std::string sheetRows(XlsxReader& r) {
+    std::string out;
+    while (r.next()) appendCsvRow(out, r.cells(), Quoting::Minimal);
+    return out;
+}
+
+// первая расходящаяся строка — чтобы ошибка была читаемой
+std::string firstDifference(const std::string& got, const std::string& want) {
+    size_t line = 1, start = 0; // start — начало строки, общее для обоих текстов
+    for (size_t i = 0; i < got.size() && i < want.size() && got[i] == want[i]; ++i)
+        if (got[i] == '\n') { ++line; start = i + 1; }
+    const auto lineOf = [start](const std::string& s) {
+        return start < s.size() ? s.substr(start, s.find('\n', start) - start) : std::string("<конец>");
+    };
+    return "строка " + std::to_string(line) + ": получено [" + lineOf(got) + "], ожидалось [" + lineOf(want) + "]";
+}
+
+// книга читается целиком и совпадает с эталонным CSV
+void checkBook(const fs::path& dir, const std::string& book, const std::string& csv) {
+    XlsxReader r;
+    if (!r.open((dir / book).string())) return report(book, "не открылась");
+    const std::string got = sheetRows(r), want = readFile(dir / csv);
+    if (r.failed()) return report(book, "Inflater сообщил об ошибке");
+    if (want.empty()) return report(book, "нет эталона " + csv);
+    report(book, got == want ? "" : firstDifference(got, want));
+}
+
+// все элементы архива распаковываются и дают размер из каталога (readAll это проверяет)
+void checkEntries(const fs::path& dir, const std::string& book, const std::vector<std::string>& names) {
+    ZipArchive zip;
+    if (!zip.open((dir / book).string())) return report(book + " (элементы)", "не открылся ZIP");
+    std::string data, error;
+    for (const auto& n : names)
+        if (!zip.readAll(n, data)) error += (error.empty() ? "не распакован " : ", ") + n;
+    report(book + " (элементы)", error);
+}
+
+// тот же XML порциями по 1..7 байт: события и текст — как при чтении одним куском
+void checkXmlChunks(const fs::path& dir, const std::string& book, const std::string& entry) {
+    const std::string name = book + " (XmlStream порциями, " + entry + ")";
+    ZipArchive zip;
+    std::string xml;
+    if (!zip.open((dir / book).string()) || !zip.readAll(entry, xml)) return report(name, "не прочитан " + entry);
+
+    auto events = [](XmlStream& x) {
+        std::string log;
+        for (XmlStream::Event ev; (ev = x.next()) != XmlStream::Event::End;) {
+            if (ev == XmlStream::Event::Text) log += "T:" + x.text() + "\n";
+            else log += (ev == XmlStream::Event::Open ? "O:" : "C:") + std::string(x.name()) + "\n";
+        }
+        return log;
+    };
+    bool whole = false;
+    XmlStream a([&](std::string_view& c) { if (whole) return false; whole = true; c = xml; return true; });
+    size_t pos = 0, step = 0;
+    XmlStream b([&](std::string_view& c) {
+        if (pos == xml.size()) return false;
+        const size_t n = std::min<size_t>(1 + step++ % 7, xml.size() - pos);
+        c = std::string_view(xml).substr(pos, n);
+        pos += n;
+        return true;
+    });
+    const std::string ea = events(a), eb = events(b);
+    report(name, ea.empty() ? "нет событий" : ea == eb ? "" : firstDifference(eb, ea));
+}
+
+// повреждённая книга: open() отказывает сразу или next() обрывается с failed()
+void checkBroken(const fs::path& dir, const std::string& book, bool openFails) {
+    XlsxReader r;
+    const bool opened = r.open((dir / book).string());
+    if (openFails) return report(book, opened ? "открылась, хотя повреждена" : "");
+    if (!opened) return report(book, "не открылась (ожидался отказ при чтении листа)");
+    sheetRows(r);
+    report(book, r.failed() ? "" : "прочитана без ошибки");
+}
+
+// processFile на повреждённой книге: код 1 и ни результата, ни временных файлов
+void checkNoPartialOutput(const fs::path& dir, const std::string& book) {
+    const std::string name = book + " (processFile)";
+    const fs::path out = fs::temp_directory_path() / ("xlsx_check_" + std::to_string((unsigned long)std::time(nullptr)));
+    std::error_code ec;
+    fs::remove_all(out, ec);
+    fs::create_directories(out, ec);
+    const ComponentDb db;
+    const int rc = processFile((dir / book).string(), outputPath(out.string(), book), false, db,
+                               [](const std::string&) { return std::optional<CompInfo>(); });
+    size_t left = 0;
+    for (const auto& e : fs::directory_iterator(out, ec)) { (void)e; ++left; }
+    fs::remove_all(out, ec);
+    report(name, rc != 1 ? "код " + std::to_string(rc) + " вместо 1" : left ? "в папке результата остались файлы" : "");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const fs::path dir = argc > 1 ? argv[1] : "fixtures/xlsx";
+    if (!fs::is_directory(dir)) { std::cerr << "Нет папки с эталонами " << dir.string() << "\n"; return 2; }
+
+    const std::vector<std::string> entries = { "[Content_Types].xml", "xl/workbook.xml", "xl/_rels/workbook.xml.rels",
+                                               "xl/strings.xml", "xl/worksheets/other.xml", "xl/worksheets/pnp.xml" };
+    checkBook(dir, "stored.xlsx", "stored.csv");                // элементы без сжатия
+    checkBook(dir, "deflate.xlsx", "deflate.csv");              // динамические коды, дальние ссылки назад
+    checkEntries(dir, "stored.xlsx", entries);
+    checkEntries(dir, "deflate.xlsx", entries);                 // + фиксированные коды и блоки без сжатия
+    checkXmlChunks(dir, "stored.xlsx", "xl/worksheets/pnp.xml");
+    checkXmlChunks(dir, "stored.xlsx", "xl/strings.xml");
+    checkBroken(dir, "truncated.xlsx", /*openFails=*/true);
+    checkBroken(dir, "corrupt.xlsx", /*openFails=*/false);
+    checkBroken(dir, "short.xlsx", /*openFails=*/false);
+    checkNoPartialOutput(dir, "corrupt.xlsx");
+    checkNoPartialOutput(dir, "short.xlsx");
+
+    std::cout << (gFailures ? "Ошибок: " + std::to_string(gFailures) : std::string("Все проверки пройдены")) << "\n";
+    return gFailures ? 1 : 0;
+}
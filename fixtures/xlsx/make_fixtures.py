@@ -0,0 +1,305 @@
+#!/usr/bin/env python3
+# Эталонные книги для XlsxCheck.cpp. Файлы уже лежат в репозитории; скрипт нужен, только
+# чтобы пересобрать их после правки (python3 make_fixtures.py в этой папке). Результат
+# детерминирован: одно и то же зерно, фиксированные даты элементов ZIP.
+#
+#   stored.xlsx    — все элементы без сжатия (метод 0); ячейки всех типов
+#   deflate.xlsx   — [Content_Types].xml с фиксированными кодами, sharedStrings — deflate-блоки
+#                    без сжатия, лист — динамические коды Хаффмана, ~300 КБ, со ссылками
+#                    назад на ~27 КБ, которые пересекают границы порций Inflater
+#   truncated.xlsx — deflate.xlsx, обрезанный посередине (нет центрального каталога)
+#   corrupt.xlsx   — deflate.xlsx, у второго deflate-блока листа зарезервированный тип 3
+#   short.xlsx     — deflate.xlsx, у листа в заголовках ZIP уменьшен размер сжатых данных
+#   *.csv          — что должен выдать XlsxReader (строки через ';', без кавычек)
+
+import random
+import struct
+import zipfile
+
+KWINDOW, KCHUNK = 32768, 65536          # как Inflater::kWindow / kChunk
+DATE = (2024, 1, 1, 0, 0, 0)
+NS = 'xmlns="http://schemas.openxmlformats.org/spreadsheetml/2006/main"'
+RELNS = 'http://schemas.openxmlformats.org/officeDocument/2006/relationships'
+
+rng = random.Random(18)
+
+
+# -------- Разбор deflate (только для проверки, что нужные случаи в потоке есть) --------
+class Bits:
+    def __init__(self, data):
+        self.data, self.pos = data, 0
+
+    def get(self, n):
+        v = 0
+        for i in range(n):
+            byte = self.data[self.pos >> 3]
+            v |= ((byte >> (self.pos & 7)) & 1) << i
+            self.pos += 1
+        return v
+
+
+def huffman(lengths):
+    code, table = 0, {}
+    for bits in range(1, 16):
+        for sym, l in enumerate(lengths):
+            if l == bits:
+                table[(bits, code)] = sym
+                code += 1
+        code <<= 1
+    return table
+
+
+def decode(br, table):
+    code = length = 0
+    while True:
+        code = (code << 1) | br.get(1)
+        length += 1
+        if (length, code) in table:
+            return table[(length, code)]
+
+
+LBASE = [3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258]
+LEXT = [0] * 8 + [1] * 4 + [2] * 4 + [3] * 4 + [4] * 4 + [5] * 4 + [0]
+DBASE = [1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073,
+         4097, 6145, 8193, 12289, 16385, 24577]
+DEXT = [0, 0, 0, 0] + [i // 2 for i in range(2, 28)]
+
+
+def analyze(stream):
+    """типы блоков, битовые смещения их заголовков и ссылки назад (начало, длина, расстояние)"""
+    br, out, blocks, matches = Bits(stream), 0, [], []
+    while True:
+        blocks.append((br.pos, None))
+        final, btype = br.get(1), br.get(2)
+        blocks[-1] = (blocks[-1][0], btype)
+        if btype == 0:
+            br.pos = (br.pos + 7) & ~7
+            n = br.get(16)
+            br.get(16)
+            br.pos += 8 * n
+            out += n
+        else:
+            if btype == 1:
+                lit = huffman([8] * 144 + [9] * 112 + [7] * 24 + [8] * 8)
+                dist = huffman([5] * 30)
+            else:
+                nlen, ndist, ncode = br.get(5) + 257, br.get(5) + 1, br.get(4) + 4
+                order = [16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15]
+                cl = [0] * 19
+                for i in range(ncode):
+                    cl[order[i]] = br.get(3)
+                ct, lengths = huffman(cl), []
+                while len(lengths) < nlen + ndist:
+                    s = decode(br, ct)
+                    if s < 16:
+                        lengths.append(s)
+                    elif s == 16:
+                        lengths += [lengths[-1]] * (3 + br.get(2))
+                    elif s == 17:
+                        lengths += [0] * (3 + br.get(3))
+                    else:
+                        lengths += [0] * (11 + br.get(7))
+                lit, dist = huffman(lengths[:nlen]), huffman(lengths[nlen:])
+            while True:
+                s = decode(br, lit)
+                if s < 256:
+                    out += 1
+                elif s == 256:
+                    break
+                else:
+                    ln = LBASE[s - 257] + br.get(LEXT[s - 257])
+                    ds = decode(br, dist)
+                    d = DBASE[ds] + br.get(DEXT[ds])
+                    matches.append((out, ln, d))
+                    out += ln
+        if final:
+            return blocks, matches, out
+
+
+def chunk_boundaries(size):
+    """смещения в распакованных данных, где Inflater сдвигает окно (конец порции)"""
+    b = KWINDOW + KCHUNK
+    while b < size:
+        yield b
+        b += KCHUNK
+
+
+# -------- Содержимое книг --------
+def esc(t):
+    return t.replace('&', '&amp;').replace('<', '&lt;').replace('>', '&gt;')
+
+
+class Sheet:
+    def __init__(self):
+        self.shared, self.index, self.rows, self.expected = [], {}, [], []
+
+    def sst(self, s):
+        if s not in self.index:
+            self.index[s] = len(self.shared)
+            self.shared.append(s)
+        return self.index[s]
+
+    def add(self, xml, expected):
+        self.rows.append(xml)
+        if expected is not None:
+            self.expected.append(expected)
+
+    def xml(self):
+        return ('<?xml version="1.0" encoding="UTF-8" standalone="yes"?>\n<worksheet %s><sheetData>' % NS
+                + ''.join(self.rows) + '</sheetData></worksheet>')
+
+    def sst_xml(self, rich=()):
+        out = ['<?xml version="1.0" encoding="UTF-8"?>\n<sst %s count="%d" uniqueCount="%d">' % (NS, len(self.shared), len(self.shared))]
+        for i, s in enumerate(self.shared):
+            if i in rich:                   # rich text из двух кусков + фонетика (не входит в текст)
+                out.append('<si><r><rPr><b/></rPr><t>%s</t></r><r><t xml:space="preserve">%s</t></r>'
+                           '<rPh sb="0" eb="1"><t>PH</t></rPh></si>' % (esc(s[:2]), esc(s[2:])))
+            else:
+                out.append('<si><t xml:space="preserve">%s</t></si>' % esc(s))
+        return ''.join(out + ['</sst>'])
+
+
+def showcase(sh):
+    """ячейки всех типов, которые разбирает XlsxReader"""
+    hdr = ['Designator', 'Mid X', 'Mid Y', 'Rotation', 'Comment', 'Layer']
+    sh.add('<row r="1">' + ''.join('<c r="%s1" t="s"><v>%d</v></c>' % ('ABCDEF'[i], sh.sst(h)) for i, h in enumerate(hdr)) + '</row>',
+           ';'.join(hdr))
+    # числа как их хранит Excel: до 15 значащих цифр
+    sh.add('<row r="2"><c r="A2" t="inlineStr"><is><t>C1</t></is></c><c r="B2"><v>9.4930000000000003</v></c>'
+           '<c r="C2" t="n"><v>1.5E+2</v></c><c r="D2"><v>-0.5</v></c>'
+           '<c r="E2" t="s"><v>%d</v></c><c r="F2" t="b"><v>1</v></c></row>' % sh.sst('0603-X7R-50V-100nF'),
+           'C1;9.493;150;-0.5;0603-X7R-50V-100nF;TRUE')
+    # пропущенная ячейка B, сущности и _xHHHH_, формула со строковым значением, ошибка
+    sh.add('<row r="3"><c r="A3" t="inlineStr"><is><t xml:space="preserve">R &amp; &lt;2&gt; a_x0042_c &#1046;</t></is></c>'
+           '<c r="C3" t="str"><f>A1</f><v>Designator</v></c><c r="D3" t="e"><v>#N/A</v></c>'
+           '<c r="E3" t="s"><v>%d</v></c><c r="F3" t="b"><v>0</v></c></row>' % sh.sst('STM32F405RGT6'),
+           'R & <2> aBc Ж;;Designator;#N/A;STM32F405RGT6;FALSE')
+    sh.add('<row r="4"></row>', None)                                        # пустая строка не выдаётся
+    # rich text в общей строке, ячейки без r (по порядку), пустая inlineStr в конце
+    sh.add('<row><c t="s"><v>%d</v></c><c><v>100</v></c><c><v>0.1</v></c><c t="inlineStr"><is><t></t></is></c></row>'
+           % sh.sst('Резистор 10к'), 'Резистор 10к;100;0.1;')
+
+
+def words(n):
+    return ''.join(rng.choice('ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz0123456789') for _ in range(n))
+
+
+def bulk(sh):
+    """~300 КБ строк; блоки по K строк повторяют предыдущий блок побайтно (ссылка назад на ~27 КБ)"""
+    comps = ['0402-X5R-6V-1uF', '0603-X7R-50V-100nF', '0805-NP0-50V-22pF', '0603-0.1W-10K-100ppm-1%',
+             'TPS5430DDA', 'LM358DR', 'AMS1117-3.3', 'SN74LVC1G08']
+    K, base = 110, []
+    for i in range(1600):
+        if (i // K) % 2 == 1:
+            xml, expected = base[i - K]
+        else:
+            des = 'U%d' % i
+            x, y, rot = rng.randint(0, 99999) / 100, rng.randint(0, 99999) / 100, rng.choice([0, 90, 180, 270])
+            comp, note = rng.choice(comps), words(24)
+            xml = ('<row><c t="inlineStr"><is><t>%s</t></is></c><c><v>%r</v></c><c><v>%r</v></c><c><v>%d</v></c>'
+                   '<c t="s"><v>%d</v></c><c t="inlineStr"><is><t>%s</t></is></c></row>'
+                   % (des, x, y, rot, sh.sst(comp), note))
+            expected = ';'.join([des, '%.15g' % x, '%.15g' % y, str(rot), comp, note])
+        base.append((xml, expected))
+        sh.add(xml, expected)
+
+
+def workbook_parts():
+    wb = ('<?xml version="1.0"?><workbook %s xmlns:r="%s"><sheets><sheet name="PnP" sheetId="1" r:id="rId3"/>'
+          '<sheet name="Other" sheetId="2" r:id="rId1"/></sheets></workbook>' % (NS, RELNS))
+    rels = ('<?xml version="1.0"?><Relationships xmlns="http://schemas.openxmlformats.org/package/2006/relationships">'
+            '<Relationship Id="rId1" Type="%s/worksheet" Target="worksheets/other.xml"/>'
+            '<Relationship Id="rId2" Type="%s/sharedStrings" Target="strings.xml"/>'
+            '<Relationship Id="rId3" Type="%s/worksheet" Target="/xl/worksheets/pnp.xml"/></Relationships>' % (RELNS, RELNS, RELNS))
+    other = '<worksheet %s><sheetData><row r="1"><c r="A1" t="inlineStr"><is><t>WRONG</t></is></c></row></sheetData></worksheet>' % NS
+    return wb, rels, other
+
+
+def write_zip(path, parts):
+    """parts: (имя, данные, метод, уровень)"""
+    with zipfile.ZipFile(path, 'w') as z:
+        for name, data, method, level in parts:
+            info = zipfile.ZipInfo(name, DATE)
+            info.compress_type = method
+            info.external_attr = 0o644 << 16
+            z.writestr(info, data.encode('utf-8'), compresslevel=level)
+
+
+def main():
+    wb, rels, other = workbook_parts()
+
+    small = Sheet()
+    showcase(small)
+    write_zip('stored.xlsx', [('[Content_Types].xml', '<Types/>', zipfile.ZIP_STORED, None),
+                              ('xl/workbook.xml', wb, zipfile.ZIP_STORED, None),
+                              ('xl/_rels/workbook.xml.rels', rels, zipfile.ZIP_STORED, None),
+                              ('xl/strings.xml', small.sst_xml(rich={small.index['Резистор 10к']}), zipfile.ZIP_STORED, None),
+                              ('xl/worksheets/other.xml', other, zipfile.ZIP_STORED, None),
+                              ('xl/worksheets/pnp.xml', small.xml(), zipfile.ZIP_STORED, None)])
+    with open('stored.csv', 'w', encoding='utf-8', newline='') as f:
+        f.write(''.join(r + '\n' for r in small.expected))
+
+    big = Sheet()
+    showcase(big)
+    bulk(big)
+    sheet = big.xml()
+    D = zipfile.ZIP_DEFLATED
+    write_zip('deflate.xlsx', [('[Content_Types].xml', '<Types/>', D, 9),
+                               ('xl/workbook.xml', wb, D, 9),
+                               ('xl/_rels/workbook.xml.rels', rels, D, 9),
+                               ('xl/strings.xml', big.sst_xml(rich={big.index['Резистор 10к']}), D, 0),
+                               ('xl/worksheets/other.xml', other, D, 9),
+                               ('xl/worksheets/pnp.xml', sheet, D, 9)])
+    with open('deflate.csv', 'w', encoding='utf-8', newline='') as f:
+        f.write(''.join(r + '\n' for r in big.expected))
+
+    # проверить, что в deflate.xlsx есть все нужные случаи
+    blob = open('deflate.xlsx', 'rb').read()
+    z = zipfile.ZipFile('deflate.xlsx')
+
+    def stream(name):
+        info = z.getinfo(name)
+        nlen, xlen = struct.unpack_from('<HH', blob, info.header_offset + 26)
+        start = info.header_offset + 30 + nlen + xlen
+        return start, info
+
+    types = {}
+    for name in ('[Content_Types].xml', 'xl/strings.xml', 'xl/worksheets/pnp.xml'):
+        start, info = stream(name)
+        blocks, matches, size = analyze(blob[start:start + info.compress_size])
+        assert size == info.file_size, name
+        types[name] = (blocks, matches, size)
+    assert {t for _, t in types['[Content_Types].xml'][0]} == {1}, '[Content_Types].xml: ожидались фиксированные коды'
+    assert {t for _, t in types['xl/strings.xml'][0]} == {0}, 'strings.xml: ожидались блоки без сжатия'
+    blocks, matches, size = types['xl/worksheets/pnp.xml']
+    assert len(blocks) >= 2 and all(t == 2 for _, t in blocks), 'лист: ожидались динамические коды, несколько блоков'
+    spanning = [m for m in matches for b in chunk_boundaries(size) if m[0] < b < m[0] + m[1] and m[2] > 16384]
+    assert spanning, 'лист: нет дальней ссылки назад через границу порции'
+
+    # повреждённые копии
+    sheet_start, sheet_info = stream('xl/worksheets/pnp.xml')
+    open('truncated.xlsx', 'wb').write(blob[:sheet_start + sheet_info.compress_size // 2])
+
+    bad = bytearray(blob)
+    bit = sheet_start * 8 + blocks[1][0] + 1           # BTYPE второго блока → 11
+    for b in (bit, bit + 1):
+        bad[b >> 3] |= 1 << (b & 7)
+    open('corrupt.xlsx', 'wb').write(bad)
+
+    short = bytearray(blob)
+    half = sheet_info.compress_size // 2
+    struct.pack_into('<I', short, sheet_info.header_offset + 18, half)     # локальный заголовок
+    pos = blob.find(b'PK\x05\x06')
+    cd_off = struct.unpack_from('<I', blob, pos + 16)[0]
+    while cd_off < pos:                                                    # центральный каталог
+        nlen, xlen, clen = struct.unpack_from('<HHH', blob, cd_off + 28)
+        if blob[cd_off + 46:cd_off + 46 + nlen] == b'xl/worksheets/pnp.xml':
+            struct.pack_into('<I', short, cd_off + 20, half)
+        cd_off += 46 + nlen + xlen + clen
+    open('short.xlsx', 'wb').write(short)
+
+    print('deflate.xlsx: лист %d байт, блоков %d, ссылок через границу порции %d' % (size, len(blocks), len(spanning)))
+
+
+if __name__ == '__main__':
+    main()